@@ -6,7 +6,12 @@ import {
   ProtoDataSegment,
   ProtoTypeInfo,
 } from "../proto/il2cpp";
-import { CreateObjectResult, GetSafePtrAddressesResult } from "../proto/qrue";
+import {
+  CreateObjectResult,
+  GetSafePtrAddressesResult,
+  GetSafePtrAddressesResult_AddressInfo,
+  SafePtrAddressesChanged,
+} from "../proto/qrue";
 import {
   areProtoClassesConvertible,
   areProtoTypesEqual,
@@ -21,6 +26,7 @@ import { bigToString, uniqueNumber } from "../utils/misc";
 import { extractCase } from "../utils/typing";
 import { getClassDetails, tryGetCachedClassDetails } from "./cache";
 import { sendPacket, sendPacketResult } from "./packets";
+import { socket } from "./socket";
 
 export type Variable = {
   id: number;
@@ -69,11 +75,22 @@ async function populateClassDetails(typeInfo?: ProtoTypeInfo) {
   if (!tryGetCachedClassDetails(classInfo)) await getClassDetails(classInfo);
 }
 
-async function allocateVariable(data?: ProtoDataSegment) {
-  if (data?.Data?.$case == "classData")
+// addresses this app is adding, which aren't made into variables when the change is sent back to it
+const allocating = new Set<bigint>();
+
+async function allocate(address: bigint) {
+  allocating.add(address);
+  try {
     await sendPacketResult({
-      addSafePtrAddress: { address: data.Data.classData, remove: false },
+      addSafePtrAddress: { address, remove: false },
     })[0];
+  } finally {
+    allocating.delete(address);
+  }
+}
+
+async function allocateVariable(data?: ProtoDataSegment) {
+  if (data?.Data?.$case == "classData") await allocate(data.Data.classData);
 }
 
 async function deallocateVariable(data?: ProtoDataSegment, check?: boolean) {
@@ -189,9 +206,7 @@ export function createScopedVariable(typeInfo: ProtoTypeInfo): ScopedVariable {
       // if we've already cleaned up, don't bother allocating
       if (valid) {
         console.log("allocate object", address);
-        await sendPacketResult({
-          addSafePtrAddress: { address, remove: false },
-        })[0];
+        await allocate(address);
       }
 
       set(setDataCase({ classData: address }));
@@ -213,6 +228,22 @@ export function createScopedVariable(typeInfo: ProtoTypeInfo): ScopedVariable {
   return { get, set, make, loading, save, transfer };
 }
 
+function referenceValue({
+  address,
+  clazz,
+}: GetSafePtrAddressesResult_AddressInfo): ProtoDataPayload {
+  return {
+    data: setDataCase({ classData: address }),
+    typeInfo: setTypeCase({ classInfo: clazz! }),
+  };
+}
+
+function referenceName(address: string, value: ProtoDataPayload) {
+  return firstFree(
+    `${extractCase(value.typeInfo?.Info, "classInfo")!.clazz}_0x${address}`,
+  );
+}
+
 export async function updateReferenceVariables() {
   const { addresses } = await sendPacketResult<GetSafePtrAddressesResult>({
     getSafePtrAddresses: {},
@@ -223,12 +254,9 @@ export async function updateReferenceVariables() {
 
   // find class details of all the new variables
   const newVariables = Object.fromEntries(
-    addresses.map(({ address, clazz }) => [
-      bigToString(address), // can't have a bigint as a key
-      {
-        data: setDataCase({ classData: address }),
-        typeInfo: setTypeCase({ classInfo: clazz! }),
-      } satisfies ProtoDataPayload,
+    addresses.map((info) => [
+      bigToString(info.address), // can't have a bigint as a key
+      referenceValue(info),
     ]),
   );
 
@@ -248,15 +276,49 @@ export async function updateReferenceVariables() {
       .concat(
         Object.entries(newVariables).map(([address, value]) => ({
           id: uniqueNumber(),
-          name: firstFree(
-            `${extractCase(value.typeInfo.Info, "classInfo")!.clazz}_0x${address}`,
-          ),
+          name: referenceName(address, value),
           value,
         })),
       ),
   );
 }
 
+// only the changed addresses are sent, so the variables are updated from them instead of the whole list
+async function applyReferenceChanges({
+  added,
+  removed,
+}: SafePtrAddressesChanged) {
+  if (removed.length > 0)
+    setVariables((vars) =>
+      vars.filter(
+        ({ value }) =>
+          value.data?.Data?.$case != "classData" ||
+          !removed.includes(value.data.Data.classData),
+      ),
+    );
+
+  added = added.filter(
+    ({ address }) =>
+      !allocating.has(address) && !findReferenceVariable(address),
+  );
+  await Promise.all(added.map(({ clazz }) => getClassDetails(clazz!)));
+  for (const info of added) {
+    // may have been added while the class details were loading
+    if (findReferenceVariable(info.address)) continue;
+    const value = referenceValue(info);
+    setVariables(variables.length, {
+      id: uniqueNumber(),
+      name: referenceName(bigToString(info.address), value),
+      value,
+    });
+  }
+}
+
+socket.addOnPacket((wrapper) => {
+  if (wrapper.Packet?.$case == "safePtrAddressesChanged")
+    applyReferenceChanges(wrapper.Packet.safePtrAddressesChanged);
+});
+
 export function findVariablesForType(typeInfo: ProtoTypeInfo) {
   return variables
     .filter(({ value: { typeInfo: variableType } }) => {
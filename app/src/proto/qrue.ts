@@ -246,7 +246,7 @@ export interface CreateObjectResult {
   address: bigint;
 }
 
-/** Returns GetSafePtrAddressesResult */
+/** Returns GetSafePtrAddressesResult with only the address if it was newly added, and sends SafePtrAddressesChanged to every connection */
 export interface AddSafePtrAddress {
   address: bigint;
   remove: boolean;
@@ -264,6 +264,12 @@ export interface GetSafePtrAddressesResult_AddressInfo {
   clazz: ProtoClassInfo | undefined;
 }
 
+/** sent to every connection when addresses are added or removed, instead of the whole list */
+export interface SafePtrAddressesChanged {
+  added: GetSafePtrAddressesResult_AddressInfo[];
+  removed: bigint[];
+}
+
 export interface GetTypeComplete {
   namespaze?: string | undefined;
   clazz?: string | undefined;
@@ -308,6 +314,7 @@ export interface PacketWrapper {
     | { $case: "getSafePtrAddressesResult"; getSafePtrAddressesResult: GetSafePtrAddressesResult }
     | { $case: "getTypeComplete"; getTypeComplete: GetTypeComplete }
     | { $case: "getTypeCompleteResult"; getTypeCompleteResult: GetTypeCompleteResult }
+    | { $case: "safePtrAddressesChanged"; safePtrAddressesChanged: SafePtrAddressesChanged }
     | undefined;
 }
 
@@ -2655,6 +2662,99 @@ export const GetSafePtrAddressesResult_AddressInfo: MessageFns<GetSafePtrAddress
   },
 };
 
+function createBaseSafePtrAddressesChanged(): SafePtrAddressesChanged {
+  return { added: [], removed: [] };
+}
+
+export const SafePtrAddressesChanged: MessageFns<SafePtrAddressesChanged> = {
+  encode(message: SafePtrAddressesChanged, writer: BinaryWriter = new BinaryWriter()): BinaryWriter {
+    for (const v of message.added) {
+      GetSafePtrAddressesResult_AddressInfo.encode(v!, writer.uint32(10).fork()).join();
+    }
+    writer.uint32(18).fork();
+    for (const v of message.removed) {
+      if (BigInt.asUintN(64, v) !== v) {
+        throw new globalThis.Error("a value provided in array field removed of type uint64 is too large");
+      }
+      writer.uint64(v);
+    }
+    writer.join();
+    return writer;
+  },
+
+  decode(input: BinaryReader | Uint8Array, length?: number): SafePtrAddressesChanged {
+    const reader = input instanceof BinaryReader ? input : new BinaryReader(input);
+    const end = length === undefined ? reader.len : reader.pos + length;
+    const message = createBaseSafePtrAddressesChanged();
+    while (reader.pos < end) {
+      const tag = reader.uint32();
+      switch (tag >>> 3) {
+        case 1: {
+          if (tag !== 10) {
+            break;
+          }
+
+          message.added.push(GetSafePtrAddressesResult_AddressInfo.decode(reader, reader.uint32()));
+          continue;
+        }
+        case 2: {
+          if (tag === 16) {
+            message.removed.push(reader.uint64() as bigint);
+
+            continue;
+          }
+
+          if (tag === 18) {
+            const end2 = reader.uint32() + reader.pos;
+            while (reader.pos < end2) {
+              message.removed.push(reader.uint64() as bigint);
+            }
+
+            continue;
+          }
+
+          break;
+        }
+      }
+      if ((tag & 7) === 4 || tag === 0) {
+        break;
+      }
+      reader.skip(tag & 7);
+    }
+    return message;
+  },
+
+  fromJSON(object: any): SafePtrAddressesChanged {
+    return {
+      added: globalThis.Array.isArray(object?.added)
+        ? object.added.map((e: any) => GetSafePtrAddressesResult_AddressInfo.fromJSON(e))
+        : [],
+      removed: globalThis.Array.isArray(object?.removed) ? object.removed.map((e: any) => BigInt(e)) : [],
+    };
+  },
+
+  toJSON(message: SafePtrAddressesChanged): unknown {
+    const obj: any = {};
+    if (message.added?.length) {
+      obj.added = message.added.map((e) => GetSafePtrAddressesResult_AddressInfo.toJSON(e));
+    }
+    if (message.removed?.length) {
+      obj.removed = message.removed.map((e) => e.toString());
+    }
+    return obj;
+  },
+
+  create<I extends Exact<DeepPartial<SafePtrAddressesChanged>, I>>(base?: I): SafePtrAddressesChanged {
+    return SafePtrAddressesChanged.fromPartial(base ?? ({} as any));
+  },
+  fromPartial<I extends Exact<DeepPartial<SafePtrAddressesChanged>, I>>(object: I): SafePtrAddressesChanged {
+    const message = createBaseSafePtrAddressesChanged();
+    message.added = object.added?.map((e) => GetSafePtrAddressesResult_AddressInfo.fromPartial(e)) || [];
+    message.removed = object.removed?.map((e) => e) || [];
+    return message;
+  },
+};
+
 function createBaseGetTypeComplete(): GetTypeComplete {
   return { namespaze: undefined, clazz: undefined };
 }
@@ -2901,6 +3001,9 @@ export const PacketWrapper: MessageFns<PacketWrapper> = {
       case "getTypeCompleteResult":
         GetTypeCompleteResult.encode(message.Packet.getTypeCompleteResult, writer.uint32(266).fork()).join();
         break;
+      case "safePtrAddressesChanged":
+        SafePtrAddressesChanged.encode(message.Packet.safePtrAddressesChanged, writer.uint32(330).fork()).join();
+        break;
     }
     return writer;
   },
@@ -3239,6 +3342,17 @@ export const PacketWrapper: MessageFns<PacketWrapper> = {
           };
           continue;
         }
+        case 41: {
+          if (tag !== 330) {
+            break;
+          }
+
+          message.Packet = {
+            $case: "safePtrAddressesChanged",
+            safePtrAddressesChanged: SafePtrAddressesChanged.decode(reader, reader.uint32()),
+          };
+          continue;
+        }
       }
       if ((tag & 7) === 4 || tag === 0) {
         break;
@@ -3345,6 +3459,11 @@ export const PacketWrapper: MessageFns<PacketWrapper> = {
           $case: "getTypeCompleteResult",
           getTypeCompleteResult: GetTypeCompleteResult.fromJSON(object.getTypeCompleteResult),
         }
+        : isSet(object.safePtrAddressesChanged)
+        ? {
+          $case: "safePtrAddressesChanged",
+          safePtrAddressesChanged: SafePtrAddressesChanged.fromJSON(object.safePtrAddressesChanged),
+        }
         : undefined,
     };
   },
@@ -3420,6 +3539,8 @@ export const PacketWrapper: MessageFns<PacketWrapper> = {
       obj.getTypeComplete = GetTypeComplete.toJSON(message.Packet.getTypeComplete);
     } else if (message.Packet?.$case === "getTypeCompleteResult") {
       obj.getTypeCompleteResult = GetTypeCompleteResult.toJSON(message.Packet.getTypeCompleteResult);
+    } else if (message.Packet?.$case === "safePtrAddressesChanged") {
+      obj.safePtrAddressesChanged = SafePtrAddressesChanged.toJSON(message.Packet.safePtrAddressesChanged);
     }
     return obj;
   },
@@ -3711,6 +3832,15 @@ export const PacketWrapper: MessageFns<PacketWrapper> = {
         }
         break;
       }
+      case "safePtrAddressesChanged": {
+        if (object.Packet?.safePtrAddressesChanged !== undefined && object.Packet?.safePtrAddressesChanged !== null) {
+          message.Packet = {
+            $case: "safePtrAddressesChanged",
+            safePtrAddressesChanged: SafePtrAddressesChanged.fromPartial(object.Packet.safePtrAddressesChanged),
+          };
+        }
+        break;
+      }
     }
     return message;
   },
@@ -0,0 +1,71 @@
+// compares how ReadMemory checks a range, changing its protection with mem::protect as it used to or looking it up with mem::readable
+// run with: cmake -S qmod/bench -B build/bench && cmake --build build/bench && build/bench/mem_bench
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "mem.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int iterations = 200000;
+    constexpr std::size_t readSize = 256;
+
+    char output[readSize];
+
+    // the bytes copied like the ReadMemory handler, or 0 if it would have returned an error
+    std::size_t ReadProtect(char const* src, std::size_t size) {
+        if (mem::protect(const_cast<char*>(src), size, mem::protection::read_write_execute))
+            return 0;
+        memcpy(output, src, size);
+        return size;
+    }
+    std::size_t ReadIndexed(char const* src, std::size_t size) {
+        size = mem::readable(src, size);
+        if (size)
+            memcpy(output, src, size);
+        return size;
+    }
+
+    // prints the nanoseconds per read, and the bytes the last one copied
+    template <typename Read>
+    void Run(char const* name, char const* kind, Read read, char const* src) {
+        std::size_t copied = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; i++)
+            copied = read(src, readSize);
+        auto elapsed = Clock::now() - start;
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        printf("%-8s %-10s %8.1f ns  %3zu bytes\n", name, kind, ns, copied);
+    }
+}
+
+int main() {
+    auto page = (std::size_t) sysconf(_SC_PAGESIZE);
+    // two readable pages followed by an unmapped one, so a read can run off the end of a mapping
+    auto pages = (char*) mmap(nullptr, page * 3, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    munmap(pages + page * 2, page);
+    memset(pages, 1, page * 2);
+
+    char const* mapped = pages + page / 2;
+    char const* edge = pages + page * 2 - readSize / 2;
+    char const* unmapped = pages + page * 2;
+
+    printf("%d reads of %zu bytes\n", iterations, readSize);
+    for (auto [kind, src] : {std::pair{"mapped", mapped}, std::pair{"edge", edge}, std::pair{"unmapped", unmapped}}) {
+        Run("protect", kind, ReadProtect, src);
+        Run("readable", kind, ReadIndexed, src);
+    }
+
+    munmap(pages, page * 2);
+    return 0;
+}
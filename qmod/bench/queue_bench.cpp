@@ -0,0 +1,123 @@
+// compares MPSCQueue against the locked vector it replaced, with producers pushing tasks while one thread drains them
+// run with: cmake -S qmod/bench -B build/bench && cmake --build build/bench && build/bench/queue_bench
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "queue.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // how the main thread runner used to schedule, with functions copied into a vector that was swapped out to run
+    class SwapQueue {
+        std::mutex mutex;
+        std::vector<std::function<void()>> functions;
+
+       public:
+        void push(std::function<void()> const& func) {
+            std::unique_lock lock(mutex);
+            functions.emplace_back(func);
+        }
+        std::size_t drain() {
+            std::unique_lock lock(mutex);
+            std::vector<std::function<void()>> copied;
+            functions.swap(copied);
+            lock.unlock();
+            for (auto const& function : copied)
+                function();
+            return copied.size();
+        }
+    };
+
+    // each push allocates both the task and the node holding it, which is most of the difference for small tasks
+    // std::function stores those inline, and the vector's storage is reused once it has grown
+    class TaskQueue {
+        MPSCQueue<Task> tasks;
+
+       public:
+        template <typename F>
+        void push(F&& func) {
+            tasks.push(std::forward<F>(func));
+        }
+        std::size_t drain() {
+            std::size_t ran = 0;
+            while (auto task = tasks.pop()) {
+                (*task)();
+                ran++;
+            }
+            return ran;
+        }
+    };
+
+    // about what a queued request captures, which is too large for std::function to store inline
+    struct Request {
+        std::shared_ptr<int> packet;
+        std::weak_ptr<void> connection;
+        std::pair<void*, std::uint64_t> key;
+        int type = 0;
+        std::size_t bytes = 0;
+        std::array<Clock::time_point, 5> times;
+    };
+
+    std::atomic<std::uint64_t> sink = 0;
+
+    // nanoseconds per task, from the first push until the last task has run
+    template <typename Queue, bool Captures>
+    double Run(int producers, int perProducer) {
+        Queue queue;
+        std::size_t ran = 0;
+        std::size_t total = (std::size_t) producers * perProducer;
+
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < producers; i++) {
+            threads.emplace_back([&queue, perProducer]() {
+                Request request{std::make_shared<int>(0)};
+                for (int j = 0; j < perProducer; j++) {
+                    if constexpr (Captures) {
+                        request.key.second = j;
+                        queue.push([request]() { sink.fetch_add(request.key.second, std::memory_order_relaxed); });
+                    } else
+                        queue.push([]() { sink.fetch_add(1, std::memory_order_relaxed); });
+                }
+            });
+        }
+        // draining like the main thread does, as it keeps up with the producers
+        while (ran < total) {
+            auto drained = queue.drain();
+            ran += drained;
+            if (!drained)
+                std::this_thread::yield();
+        }
+        auto elapsed = Clock::now() - start;
+        for (auto& thread : threads)
+            thread.join();
+        return std::chrono::duration<double, std::nano>(elapsed).count() / total;
+    }
+
+    template <bool Captures>
+    void Compare(char const* name) {
+        constexpr int perProducer = 500000;
+        std::printf("%s\n%-10s %14s %14s\n", name, "producers", "mpsc ns/task", "swap ns/task");
+        for (int producers : {1, 2, 4, 8}) {
+            // the first run of each warms up the allocator
+            Run<TaskQueue, Captures>(producers, perProducer / 10);
+            auto mpsc = Run<TaskQueue, Captures>(producers, perProducer);
+            Run<SwapQueue, Captures>(producers, perProducer / 10);
+            auto swap = Run<SwapQueue, Captures>(producers, perProducer);
+            std::printf("%-10d %14.1f %14.1f\n", producers, mpsc, swap);
+        }
+    }
+}
+
+int main() {
+    Compare<false>("empty tasks");
+    Compare<true>("tasks capturing a request");
+}
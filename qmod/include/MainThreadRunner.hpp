@@ -1,18 +1,46 @@
 #pragma once
 
+#include <chrono>
+
 #include "UnityEngine/MonoBehaviour.hpp"
 #include "custom-types/shared/macros.hpp"
+#include "queue.hpp"
+
+namespace QRUE {
+    // interactive functions always run before any waiting bulk ones
+    enum class Priority { Interactive, Bulk };
+
+    struct FrameStats {
+        // frames that ran scheduled functions, and those that went over the budget doing so
+        std::uint64_t frames = 0;
+        std::uint64_t overBudget = 0;
+        // the furthest a single frame has gone past the budget, since a function can't be stopped partway
+        std::chrono::microseconds worstOverrun{0};
+        // functions left waiting for the next frame at the end of the last one
+        std::size_t carried = 0;
+    };
+}
 
 DECLARE_CLASS_CODEGEN(QRUE, MainThreadRunner, UnityEngine::MonoBehaviour) {
-    DECLARE_INSTANCE_FIELD(ListW<Il2CppObject*>, keepAliveObjects);
     DECLARE_INSTANCE_METHOD(void, Awake);
     DECLARE_INSTANCE_METHOD(void, Update);
 
-    DECLARE_STATIC_METHOD(void, AddKeepAlive, Il2CppObject* obj);
-    DECLARE_STATIC_METHOD(void, RemoveKeepAlive, Il2CppObject* obj);
     DECLARE_STATIC_METHOD(MainThreadRunner*, GetInstance);
     DECLARE_STATIC_METHOD(void, Init);
 
    public:
-    static void Schedule(std::function<void()> const& func);
+    // safe to call from any thread, and runs immediately when called on the main thread
+    static void Schedule(Task func, Priority priority = Priority::Interactive);
+    // time spent running scheduled functions each frame before the rest are left for the next, or 0 for no limit
+    static void SetFrameBudget(std::chrono::microseconds budget);
+    static std::chrono::microseconds GetFrameBudget();
+    static FrameStats GetFrameStats();
+    // called at the start of every frame, before any scheduled functions
+    static void SetFrameCallback(void (*callback)());
+
+    // pins objects with gc handles so they stay valid while the app uses them
+    // these return false if the object was already kept alive, or wasn't when removing
+    static bool AddKeepAlive(Il2CppObject* obj);
+    static bool RemoveKeepAlive(Il2CppObject* obj);
+    static std::vector<Il2CppObject*> GetKeepAlive();
 };
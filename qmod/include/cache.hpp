@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+struct CacheStats {
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    std::size_t budget = 0;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+};
+
+// a thread safe cache split into shards that each have their own lock, limited to a number of bytes
+// lookups only take a shared lock and mark the entry as used, and eviction is least recently used by the clock algorithm
+// values are copied out, so large ones should be shared pointers
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedCache {
+    struct Entry {
+        Value value;
+        std::size_t bytes;
+        mutable std::atomic<bool> used = true;
+
+        Entry(Value value, std::size_t bytes) : value(std::move(value)), bytes(bytes) {}
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<Key, Entry, Hash> entries;
+        // every key in insertion order, swept by the hand when evicting
+        std::list<Key> clock;
+        typename std::list<Key>::iterator hand = clock.end();
+        std::size_t bytes = 0;
+    };
+
+    std::vector<Shard> shards;
+    std::atomic<std::size_t> budget;
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> misses = 0;
+    std::atomic<std::uint64_t> evictions = 0;
+
+    Shard& GetShard(Key const& key) {
+        // mixed so that aligned pointers still spread between shards
+        std::uint64_t hash = Hash{}(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return shards[hash % shards.size()];
+    }
+
+    void Evict(Shard& shard, std::size_t limit) {
+        while (shard.bytes > limit && !shard.clock.empty()) {
+            if (shard.hand == shard.clock.end())
+                shard.hand = shard.clock.begin();
+            auto& entry = shard.entries.find(*shard.hand)->second;
+            // recently used entries get another pass
+            if (entry.used.exchange(false, std::memory_order_relaxed)) {
+                shard.hand++;
+                continue;
+            }
+            shard.bytes -= entry.bytes;
+            shard.entries.erase(*shard.hand);
+            shard.hand = shard.clock.erase(shard.hand);
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+   public:
+    ShardedCache(std::size_t budget, std::size_t shardCount = 16) : shards(shardCount), budget(budget) {}
+
+    std::optional<Value> Find(Key const& key) {
+        auto& shard = GetShard(key);
+        std::shared_lock lock(shard.mutex);
+        auto found = shard.entries.find(key);
+        if (found == shard.entries.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        hits.fetch_add(1, std::memory_order_relaxed);
+        found->second.used.store(true, std::memory_order_relaxed);
+        return found->second.value;
+    }
+
+    // keeps and returns the existing value if another thread added one first
+    Value Insert(Key const& key, Value value, std::size_t bytes) {
+        auto& shard = GetShard(key);
+        std::unique_lock lock(shard.mutex);
+        auto [found, added] = shard.entries.try_emplace(key, std::move(value), bytes);
+        if (!added)
+            return found->second.value;
+
+        // inserted just behind the hand, so it is the last to be checked
+        shard.clock.insert(shard.hand, key);
+        shard.bytes += bytes;
+        auto ret = found->second.value;
+        Evict(shard, budget.load(std::memory_order_relaxed) / shards.size());
+        return ret;
+    }
+
+    // without counting as a hit or miss, or marking the entry as used
+    bool Contains(Key const& key) {
+        auto& shard = GetShard(key);
+        std::shared_lock lock(shard.mutex);
+        return shard.entries.contains(key);
+    }
+
+    void SetBudget(std::size_t bytes) {
+        budget = bytes;
+        for (auto& shard : shards) {
+            std::unique_lock lock(shard.mutex);
+            Evict(shard, bytes / shards.size());
+        }
+    }
+
+    CacheStats GetStats() const {
+        CacheStats stats;
+        for (auto& shard : shards) {
+            std::shared_lock lock(shard.mutex);
+            stats.entries += shard.entries.size();
+            stats.bytes += shard.bytes;
+        }
+        stats.budget = budget;
+        stats.hits = hits;
+        stats.misses = misses;
+        stats.evictions = evictions;
+        return stats;
+    }
+};
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
+#include "cache.hpp"
 #include "qrue.pb.h"
 
 size_t fieldTypeSize(Il2CppType const* type);
+bool ContainsAnyCase(std::string_view const& str1, std::string_view const& str2);
 
 #define typeofclass(clazz) (&clazz->byval_arg)
 #define classoftype(type) il2cpp_functions::class_from_il2cpp_type(type)
@@ -51,4 +53,9 @@ namespace ClassUtils {
     Il2CppType* GetType(ProtoTypeInfo const& typeInfo);
 
     std::set<std::string> SearchClasses(GetTypeComplete const& search);
+
+    // adds info built elsewhere, such as saved by the metadata warm-up
+    void CacheTypeInfo(Il2CppType const* type, ProtoTypeInfo const& info);
+    CacheStats GetTypeInfoCacheStats();
+    void SetTypeInfoCacheBudget(std::size_t bytes);
 }
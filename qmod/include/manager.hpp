@@ -1,8 +1,17 @@
 #pragma once
 
 #include "qrue.pb.h"
+#include "socket.hpp"
+#include "stats.hpp"
 
 namespace Manager {
     void Init();
-    void ProcessMessage(PacketWrapper const& packet);
+    // stops the warm-up, closes every connection and joins the io and worker threads, which runs at exit before their statics are destroyed
+    void Stop();
+    // fills the metadata caches on a background thread until they are mostly full, loading and saving them for the build
+    void WarmUp(std::string build);
+    // schedules a request on the main thread, by the priority of its type, unless it is cancelled before it starts
+    void QueueMessage(std::shared_ptr<PacketWrapper const> request, Socket::Connection const& connection, Stats::Trace trace = {});
+    // the reply shares ownership of the request, so it can be built on the request's arena
+    void ProcessMessage(std::shared_ptr<PacketWrapper const> const& request, Socket::Connection const& connection, Stats::Trace trace = {});
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <new>
 #include <span>
 
@@ -37,6 +38,15 @@ namespace mem {
         return protect(data, N, prot);
     }
 
+    // how many bytes from the start of the range are mapped readable, checked against an index of /proc/self/maps
+    // the index is reloaded if the range isn't covered, since the mappings may have changed, but at most every 100ms
+    std::size_t readable(void const*, std::size_t) noexcept;
+
+#ifdef ALLOCATION_STATS
+    // heap allocations made by this mod on the current thread so far
+    std::uint64_t allocations() noexcept;
+#endif
+
     struct aligned_t {};
     constexpr aligned_t aligned = {};
 }
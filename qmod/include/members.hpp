@@ -3,6 +3,9 @@
 #include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
 #include "qrue.pb.h"
 
+// outputs only the elements in [begin, end), so huge arrays can be sent in several parts
+ProtoDataSegment OutputArray(ProtoArrayInfo const& info, Il2CppArray* arr, std::size_t begin, std::size_t end);
+
 namespace MethodUtils {
     struct MethodResult {
         ProtoDataPayload result;
@@ -18,9 +21,41 @@ namespace MethodUtils {
     ProtoMethodInfo GetMethodInfo(MethodInfo const* method);
 };
 
+// the fields and property getters of a class and its parents, resolved once so that an instance is read in one pass
+class AccessorPlan {
+    struct Field {
+        std::uint64_t id;
+        FieldInfo const* field;
+        bool isStatic;
+        int offset;
+        ProtoTypeInfo type;
+    };
+    struct Getter {
+        std::uint64_t id;
+        MethodInfo const* method;
+        bool isStatic;
+        ProtoTypeInfo type;
+    };
+
+    std::vector<Field> fields;
+    std::vector<Getter> getters;
+
+   public:
+    void AddField(std::uint64_t id, FieldInfo const* field);
+    void AddGetter(std::uint64_t id, MethodInfo const* getter);
+
+    // a plan with only the members with these ids
+    AccessorPlan Select(std::set<std::uint64_t> const& ids) const;
+
+    std::size_t SpaceUsed() const;
+    void Read(ProtoDataPayload const& instance, GetInstanceValuesResult& ret) const;
+};
+
 namespace FieldUtils {
     ProtoDataPayload Get(FieldInfo const* field, ProtoDataPayload const& object);
     ProtoDataPayload Get(FieldInfo const* field, void* object, bool isObject = true);
+    // the unconverted value of an array field, or null if it isn't one
+    Il2CppArray* GetArray(FieldInfo const* field, ProtoDataPayload const& object);
     void Set(FieldInfo const* field, ProtoDataPayload const& object, ProtoDataPayload const& arg);
     void Set(FieldInfo const* field, void* object, ProtoDataPayload const& arg, bool isObject = true);
 
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+// a move only std::function<void()>, so that captures such as packets are never copied
+class Task {
+    struct Base {
+        virtual ~Base() = default;
+        virtual void operator()() = 0;
+    };
+    template <typename F>
+    struct Impl : Base {
+        F func;
+        Impl(F&& func) : func(std::move(func)) {}
+        void operator()() override { func(); }
+    };
+
+    std::unique_ptr<Base> impl;
+
+   public:
+    Task() = default;
+    template <typename F>
+    requires(!std::is_same_v<std::decay_t<F>, Task> && std::is_invocable_v<std::decay_t<F>&>)
+    Task(F&& func) : impl(std::make_unique<Impl<std::decay_t<F>>>(std::decay_t<F>(std::forward<F>(func)))) {}
+
+    explicit operator bool() const { return impl != nullptr; }
+    void operator()() { (*impl)(); }
+};
+
+// unbounded multi producer single consumer queue, based on Dmitry Vyukov's intrusive mpsc node queue
+// pushing never blocks, and popping may miss an item whose push hasn't finished yet until the next pop
+template <typename T>
+class MPSCQueue {
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        T value;
+    };
+
+    // producers swap themselves in at the head, and the consumer follows the links from the tail
+    std::atomic<Node*> head;
+    Node* tail;
+    std::atomic<std::size_t> count = 0;
+
+   public:
+    MPSCQueue() : head(new Node()), tail(head.load()) {}
+    ~MPSCQueue() {
+        while (tail) {
+            auto next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+    MPSCQueue(MPSCQueue const&) = delete;
+    MPSCQueue& operator=(MPSCQueue const&) = delete;
+
+    // safe to call from any thread
+    void push(T value) {
+        auto node = new Node();
+        node->value = std::move(value);
+        count.fetch_add(1, std::memory_order_relaxed);
+        auto prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // only safe to call from the one consumer thread
+    std::optional<T> pop() {
+        auto next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return std::nullopt;
+        // the popped node stays as the new empty tail
+        std::optional<T> ret(std::move(next->value));
+        delete tail;
+        tail = next;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return ret;
+    }
+
+    // may include items still being pushed
+    std::size_t size() const { return count.load(std::memory_order_relaxed); }
+};
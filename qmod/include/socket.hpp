@@ -1,10 +1,59 @@
 #pragma once
 
+#include <memory>
+
 #include "qrue.pb.h"
+#include "queue.hpp"
+#include "stats.hpp"
 
 namespace Socket {
+    // same as websocketpp::connection_hdl, without needing the websocketpp headers everywhere
+    using Connection = std::weak_ptr<void>;
+
+    struct PeerStats {
+        // packets waiting to be serialized, and the most that have been waiting at once
+        std::size_t queued = 0;
+        std::size_t peakQueued = 0;
+        // bytes handed to websocketpp but not yet written
+        std::size_t buffered = 0;
+        std::uint64_t sent = 0;
+        std::uint64_t bytes = 0;
+        // packets large enough to be compressed, if the connection supports it
+        std::uint64_t compressed = 0;
+        // notifications discarded because the queue was full, or replaced by a newer one
+        std::uint64_t dropped = 0;
+        std::uint64_t coalesced = 0;
+        // times sending paused because the connection was above the high water mark
+        std::uint64_t stalls = 0;
+        // times the connection stopped being read from because the queue was full of replies
+        std::uint64_t readPauses = 0;
+    };
+
     void Init();
-    bool Start(int port);
+    // websockets are served on port, and varint length prefixed packets on streamPort and the abstract
+    // unix socket "questeditor", for wired connections that don't need websocket framing
+    bool Start(int port, int streamPort = 0, int threads = 2);
     void Stop();
-    void Send(PacketWrapper const& packet);
+    // queues for only the connection a query came from, which is never dropped
+    // if the queue is full the connection isn't read from until it drains, so it can't keep adding to it
+    // returns false if the packet couldn't be queued, because the connection has closed
+    bool Send(PacketWrapper packet, Connection const& connection);
+    // onSent runs on an io thread once the packet has been written, and is dropped without running if the connection closes
+    void Send(PacketWrapper packet, Connection const& connection, Task onSent);
+    // the packet is kept alive until it has been serialized, along with anything it shares ownership with like an arena
+    bool Send(std::shared_ptr<PacketWrapper const> packet, Connection const& connection, Stats::Trace const& trace = {});
+    // for a PacketWrapper that has already been encoded
+    void SendSerialized(std::string packet, Connection const& connection, Stats::Trace const& trace = {});
+    // queues for every connection, for notifications that aren't a reply to a query
+    // replaceable ones are dropped if a newer one of the same type is queued before they are sent
+    void Send(PacketWrapper const& packet, bool replaceable = true);
+    // whether the connection's queue is at least half full, so pushes the main thread makes on its own should wait
+    // this leaves the rest of the queue for replies, which would otherwise stop the connection being read from
+    bool IsBackedUp(Connection const& connection);
+
+    // packets at least this large are sent with permessage-deflate when the connection negotiated it
+    void SetCompressionThreshold(std::size_t bytes);
+    std::size_t GetCompressionThreshold();
+
+    std::vector<PeerStats> GetStats();
 }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "qrue.pb.h"
+
+namespace Stats {
+    using Clock = std::chrono::steady_clock;
+
+    // log-linear buckets with four per power of two, so values are within 25% up to about an hour in microseconds
+    class Histogram {
+        static constexpr int subBits = 2;
+        static constexpr int maxBits = 32;
+        std::array<std::uint64_t, (maxBits - subBits + 1) << subBits> counts{};
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0;
+        std::uint64_t max = 0;
+
+        static std::size_t Bucket(std::uint64_t value);
+        static std::uint64_t BucketMax(std::size_t bucket);
+
+       public:
+        void Record(std::uint64_t value);
+        // the highest value that could be in the bucket the percentile falls in
+        std::uint64_t Percentile(double percentile) const;
+        void Fill(ProtoLatency& latency) const;
+    };
+
+    // timestamps for a request as it moves through the server, all unset until reached
+    struct Trace {
+        // the PacketWrapper case of the request, or 0 for packets that aren't a reply
+        int type = 0;
+        std::size_t bytes = 0;
+        Clock::time_point received, parsed, queued, started, finished;
+    };
+
+    // the request's side, once its handler has finished or it was dropped before starting
+    void RecordRequest(Trace const& trace);
+    // packets without a trace, such as notifications and streamed chunks, are counted under their own type
+    void RecordReply(
+        Trace const& trace, int type, Clock::time_point serializing, Clock::time_point serialized, Clock::time_point sent, std::size_t bytes
+    );
+
+    void Fill(GetServerStatsResult& result);
+    void Reset();
+}
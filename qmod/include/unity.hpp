@@ -1,10 +1,40 @@
 #pragma once
 
 #include "UnityEngine/GameObject.hpp"
+#include "UnityEngine/Transform.hpp"
 #include "qrue.pb.h"
 
-ProtoGameObject ReadGameObject(UnityEngine::GameObject* obj);
+// these fill a message owned by the caller, so results can be built directly on the request's arena
+void ReadGameObject(UnityEngine::GameObject* obj, ProtoGameObject& packet);
 
-GetGameObjectComponentsResult GetComponents(UnityEngine::GameObject* obj);
-SearchObjectsResult FindObjects(Il2CppClass* clazz, std::string name);
-GetAllGameObjectsResult FindAllGameObjects();
+void GetComponents(UnityEngine::GameObject* obj, GetGameObjectComponentsResult& result);
+// children in [offset, offset + limit), or all after offset with limit 0, each followed by depth levels of its own children
+void FindChildren(UnityEngine::Transform* transform, std::uint32_t offset, std::uint32_t limit, std::uint32_t depth, GetChildrenResult& result);
+// the roots of every loaded scene, or only the one with the scene handle, paged the same way in each scene
+void FindSceneRoots(std::optional<int> scene, std::uint32_t offset, std::uint32_t limit, GetSceneRootsResult& result);
+void FindObjects(Il2CppClass* clazz, std::string name, SearchObjectsResult& result);
+// throws std::regex_error if a regex filter is invalid
+void FilterGameObjects(QueryGameObjects const& query, Il2CppClass* component, QueryGameObjectsResult& result);
+// with since, only the objects added or changed after that generation are included, along with the removed ids
+void FindAllGameObjects(GetAllGameObjectsResult& result, std::optional<std::uint64_t> since = std::nullopt);
+
+// the same result as FindAllGameObjects a part at a time, so it can be sent as fast as the connection takes it
+// the changes are all found up front, and then each part's objects are read as it is made, skipping any destroyed since
+class HierarchyStream {
+    ArrayW<UnityEngine::GameObject*> objects;
+    std::uint32_t handle;
+    // positions of the changed objects in objects
+    std::vector<std::uint32_t> indices;
+    std::size_t next = 0;
+    // the scenes, removed ids and generation, which go in the last part
+    GetAllGameObjectsResult last;
+
+   public:
+    explicit HierarchyStream(std::optional<std::uint64_t> since);
+    ~HierarchyStream();
+    HierarchyStream(HierarchyStream const&) = delete;
+    HierarchyStream& operator=(HierarchyStream const&) = delete;
+
+    // adds up to count more objects to result, returning true for the last part
+    bool Next(std::size_t count, GetAllGameObjectsResult& result);
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "queue.hpp"
+
+// threads attached to il2cpp, for work that only reads metadata or memory and so doesn't need the main thread
+namespace Workers {
+    void Start(int threads = 2);
+    void Stop();
+    void Schedule(Task task);
+}
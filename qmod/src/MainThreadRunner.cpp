@@ -8,23 +8,31 @@ DEFINE_TYPE(QRUE, MainThreadRunner);
 using namespace QRUE;
 
 static std::thread::id mainThreadId;
-static std::vector<std::function<void()>> scheduledFunctions;
-static std::mutex scheduleLock;
+static MPSCQueue<Task> scheduledFunctions;
+static MPSCQueue<Task> scheduledBulkFunctions;
+static std::mutex statsLock;
+
+// a 72hz frame is under 14ms, most of which the game needs
+static std::atomic<std::chrono::microseconds> frameBudget = std::chrono::microseconds(2000);
+static FrameStats frameStats;
+static std::atomic<void (*)()> frameCallback = nullptr;
 static MainThreadRunner* instance;
 
+static std::unordered_map<Il2CppObject*, std::uint32_t> keepAliveHandles;
+static std::mutex keepAliveLock;
+
 void MainThreadRunner::Awake() {
     mainThreadId = std::this_thread::get_id();
     instance = this;
-    this->keepAliveObjects = System::Collections::Generic::List_1<Il2CppObject*>::New_ctor();
 }
 
-void MainThreadRunner::Schedule(std::function<void()> const& func) {
+void MainThreadRunner::Schedule(Task func, Priority priority) {
     if (mainThreadId == std::this_thread::get_id())
         func();
-    else {
-        std::unique_lock<std::mutex> lock(scheduleLock);
-        scheduledFunctions.emplace_back(func);
-    }
+    else if (priority == Priority::Bulk)
+        scheduledBulkFunctions.push(std::move(func));
+    else
+        scheduledFunctions.push(std::move(func));
 }
 
 MainThreadRunner* MainThreadRunner::GetInstance() {
@@ -37,26 +45,86 @@ void MainThreadRunner::Init() {
     object->AddComponent<MainThreadRunner*>();
 }
 
+void MainThreadRunner::SetFrameBudget(std::chrono::microseconds budget) {
+    frameBudget = budget;
+}
+
+std::chrono::microseconds MainThreadRunner::GetFrameBudget() {
+    return frameBudget;
+}
+
+void MainThreadRunner::SetFrameCallback(void (*callback)()) {
+    frameCallback = callback;
+}
+
+FrameStats MainThreadRunner::GetFrameStats() {
+    std::unique_lock<std::mutex> lock(statsLock);
+    return frameStats;
+}
+
+static std::optional<Task> PopScheduled() {
+    if (auto task = scheduledFunctions.pop())
+        return task;
+    return scheduledBulkFunctions.pop();
+}
+
 void MainThreadRunner::Update() {
-    if (scheduledFunctions.empty())
+    if (auto callback = frameCallback.load())
+        callback();
+
+    // anything scheduled while running waits for the next frame, even without a budget
+    std::size_t remaining = scheduledFunctions.size() + scheduledBulkFunctions.size();
+    if (remaining == 0)
         return;
 
-    std::unique_lock<std::mutex> lock(scheduleLock);
-    std::vector<std::function<void()>> copiedFunctions;
-    scheduledFunctions.swap(copiedFunctions);
-    lock.unlock();
+    auto budget = frameBudget.load();
+    auto start = std::chrono::steady_clock::now();
+    for (; remaining > 0; remaining--) {
+        if (budget.count() > 0 && std::chrono::steady_clock::now() - start >= budget)
+            break;
+        // taken one at a time so that interactive functions can skip ahead of bulk ones mid frame
+        auto function = PopScheduled();
+        if (!function)
+            break;
+        (*function)();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
 
-    for (auto const& function : copiedFunctions)
-        function();
+    std::unique_lock<std::mutex> lock(statsLock);
+    frameStats.frames++;
+    frameStats.carried = remaining;
+    if (budget.count() > 0 && (remaining > 0 || elapsed > budget)) {
+        frameStats.overBudget++;
+        if (elapsed - budget > frameStats.worstOverrun) {
+            frameStats.worstOverrun = elapsed - budget;
+            LOG_INFO("Frame took {}us with a budget of {}us, {} functions left", elapsed.count(), budget.count(), remaining);
+        }
+    }
 }
 
-void MainThreadRunner::AddKeepAlive(Il2CppObject* obj) {
-    auto objects = GetInstance()->keepAliveObjects;
-    if (objects->Contains(obj))
-        return;
-    objects->Add(obj);
+bool MainThreadRunner::AddKeepAlive(Il2CppObject* obj) {
+    std::unique_lock<std::mutex> lock(keepAliveLock);
+    auto [entry, added] = keepAliveHandles.try_emplace(obj, 0);
+    if (added)
+        entry->second = il2cpp_functions::gchandle_new(obj, false);
+    return added;
+}
+
+bool MainThreadRunner::RemoveKeepAlive(Il2CppObject* obj) {
+    std::unique_lock<std::mutex> lock(keepAliveLock);
+    auto entry = keepAliveHandles.find(obj);
+    if (entry == keepAliveHandles.end())
+        return false;
+    il2cpp_functions::gchandle_free(entry->second);
+    keepAliveHandles.erase(entry);
+    return true;
 }
 
-void MainThreadRunner::RemoveKeepAlive(Il2CppObject* obj) {
-    GetInstance()->keepAliveObjects->Remove(obj);
+std::vector<Il2CppObject*> MainThreadRunner::GetKeepAlive() {
+    std::unique_lock<std::mutex> lock(keepAliveLock);
+    std::vector<Il2CppObject*> ret;
+    ret.reserve(keepAliveHandles.size());
+    for (auto const& [obj, _] : keepAliveHandles)
+        ret.emplace_back(obj);
+    return ret;
 }
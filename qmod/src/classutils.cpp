@@ -8,7 +8,8 @@
 using namespace ClassUtils;
 using namespace il2cpp_utils;
 
-static std::unordered_map<Il2CppType const*, ProtoTypeInfo> typeInfoCache;
+// shared between the main thread and the workers
+static ShardedCache<Il2CppType const*, ProtoTypeInfo> typeInfoCache(16 * 1024 * 1024);
 
 // basically copied from il2cpp (field setting). what could go wrong?
 // (so blame them for the gotos)
@@ -197,10 +198,9 @@ ProtoTypeInfo ClassUtils::GetTypeInfo(Il2CppType const* type, bool param) {
     LOG_DEBUG("Getting type info {} (param: {})", il2cpp_functions::type_get_name(type), param);
     LOG_DEBUG("Type enum {}", (int) type->type);
 
-    auto cached = typeInfoCache.find(type);
-    if (cached != typeInfoCache.end()) {
+    if (auto cached = typeInfoCache.Find(type)) {
         LOG_DEBUG("Returning cached type info");
-        return cached->second;
+        return *cached;
     }
 
     ProtoTypeInfo info;
@@ -243,11 +243,23 @@ ProtoTypeInfo ClassUtils::GetTypeInfo(Il2CppType const* type, bool param) {
     } else
         info.set_byref_(ProtoTypeInfo_Byref_NONE);
 
-    typeInfoCache[type] = info;
+    typeInfoCache.Insert(type, info, info.SpaceUsedLong());
 
     return info;
 }
 
+void ClassUtils::CacheTypeInfo(Il2CppType const* type, ProtoTypeInfo const& info) {
+    typeInfoCache.Insert(type, info, info.SpaceUsedLong());
+}
+
+CacheStats ClassUtils::GetTypeInfoCacheStats() {
+    return typeInfoCache.GetStats();
+}
+
+void ClassUtils::SetTypeInfoCacheBudget(std::size_t bytes) {
+    typeInfoCache.SetBudget(bytes);
+}
+
 ProtoTypeInfo::Primitive ClassUtils::GetPrimitive(Il2CppType const* primitiveType) {
     switch (primitiveType->type) {
         case IL2CPP_TYPE_BOOLEAN:
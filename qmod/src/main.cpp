@@ -4,6 +4,7 @@
 #include <websocketpp/server.hpp>
 
 #include "MainThreadRunner.hpp"
+#include "UnityEngine/Application.hpp"
 #include "UnityEngine/Color.hpp"
 #include "UnityEngine/Events/UnityAction_2.hpp"
 #include "UnityEngine/FilterMode.hpp"
@@ -28,6 +29,11 @@
 
 static modloader::ModInfo modInfo{MOD_ID, VERSION, 1};
 
+std::string_view GetDataPath() {
+    static std::string path = getDataDir(modInfo);
+    return path;
+}
+
 extern "C" void setup(CModInfo* info) {
     Paper::Logger::RegisterFileContextId(MOD_ID);
 
@@ -76,4 +82,10 @@ extern "C" void load() {
 extern "C" void late_load() {
     LOG_INFO("Initializing main thread runner");
     QRUE::MainThreadRunner::Init();
+
+#ifdef METADATA_WARMUP
+    // saved metadata is only valid for the build of the game and mod it was saved by
+    LOG_INFO("Starting metadata warm-up");
+    Manager::WarmUp(fmt::format("{} {}", static_cast<std::string>(UnityEngine::Application::get_version()), VERSION));
+#endif
 }
@@ -1,6 +1,24 @@
 #include "manager.hpp"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <shared_mutex>
+#include <thread>
+
 #include "MainThreadRunner.hpp"
+#include "UnityEngine/Component.hpp"
+#include "UnityEngine/Object.hpp"
 #include "UnityEngine/Transform.hpp"
 #include "classutils.hpp"
 #include "main.hpp"
@@ -8,6 +26,7 @@
 #include "members.hpp"
 #include "socket.hpp"
 #include "unity.hpp"
+#include "workers.hpp"
 
 #define MESSAGE_LOGGING
 
@@ -16,14 +35,36 @@ using namespace UnityEngine;
 using namespace UnityEngine::SceneManagement;
 
 static bool initialized = false;
+// the warm-up uses the caches, so it is stopped and joined before they are destroyed at exit
+static std::thread warmUpThread;
+static std::atomic_bool warmUpStopped = false;
+
+// sends the values that changed for every watch, each frame
+static void ReadWatches();
 
 void Manager::Init() {
+    Workers::Start();
+    QRUE::MainThreadRunner::SetFrameCallback(ReadWatches);
     Socket::Init();
-    LOG_INFO("Starting server at port 3306");
-    Socket::Start(3306);
+    LOG_INFO("Starting server at port 3306, streams at port 3307");
+    Socket::Start(3306, 3307);
+    // joinable threads left in a static vector would terminate the game when it is destroyed
+    std::atexit(Manager::Stop);
     initialized = true;
 }
 
+void Manager::Stop() {
+    if (!initialized)
+        return;
+    LOG_INFO("Stopping server");
+    warmUpStopped = true;
+    if (warmUpThread.joinable())
+        warmUpThread.join();
+    Socket::Stop();
+    Workers::Stop();
+    initialized = false;
+}
+
 bool TryValidatePtr(void const* ptr) {
     if (asInt(ptr) <= 0 || asInt(ptr) > UINTPTR_MAX) {
         LOG_INFO("invalid ptr was {}", fmt::ptr(ptr));
@@ -38,10 +79,57 @@ bool TryValidatePtr(void const* ptr) {
     wrapper.set_inputerror(fmt::format(__VA_ARGS__)); \
 }
 
-static void SetField(SetField const& packet, uint64_t queryId) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(queryId);
+// chunks of a streamed result that may be waiting to be sent at once, as the next is only made when one has been sent
+static constexpr int chunksInFlight = 4;
+
+// a streamed result, made a chunk at a time on the main thread so a slow connection holds it up instead of filling its queue
+// chunks are built on the heap instead of the request's arena, so each is freed once it is sent
+struct ChunkStream {
+    Socket::Connection connection;
+    // the next chunk, with its query id and sequence set
+    PacketWrapper chunk;
+    // fills in the chunk's result, returning true for the last one
+    std::function<bool(PacketWrapper& chunk)> fill;
+    bool done = false;
+
+    ~ChunkStream() {
+        // the last reference can be dropped on an io thread, but fill may hold gc handles
+        QRUE::MainThreadRunner::Schedule([fill = std::move(fill)]() {});
+    }
+};
+
+static void SendNextChunk(std::shared_ptr<ChunkStream> const& stream) {
+    if (stream->done)
+        return;
+    stream->done = stream->fill(stream->chunk);
+    auto info = stream->chunk.mutable_chunk();
+    info->set_last(stream->done);
+
+    PacketWrapper next;
+    if (!stream->done) {
+        next.set_queryresultid(stream->chunk.queryresultid());
+        next.mutable_chunk()->set_sequence(info->sequence() + 1);
+    }
+    stream->chunk.Swap(&next);
+    // if the connection closes, its queue is dropped along with the references to the stream
+    Socket::Send(std::move(next), stream->connection, [stream, last = stream->done]() {
+        if (!last)
+            QRUE::MainThreadRunner::Schedule([stream]() { SendNextChunk(stream); }, QRUE::Priority::Bulk);
+    });
+}
 
+// the reply wrapper is left empty, as every chunk including the last is sent from here
+static void StreamChunks(PacketWrapper const& wrapper, Socket::Connection const& connection, std::function<bool(PacketWrapper& chunk)> fill) {
+    auto stream = std::make_shared<ChunkStream>();
+    stream->connection = connection;
+    stream->chunk.set_queryresultid(wrapper.queryresultid());
+    stream->chunk.mutable_chunk();
+    stream->fill = std::move(fill);
+    for (int i = 0; i < chunksInFlight; i++)
+        SendNextChunk(stream);
+}
+
+static void SetField(SetField const& packet, PacketWrapper& wrapper) {
     auto field = asPtr(FieldInfo, packet.fieldid());
 
     if (!TryValidatePtr(field))
@@ -52,123 +140,302 @@ static void SetField(SetField const& packet, uint64_t queryId) {
         FieldUtils::Set(field, packet.inst(), packet.value());
         wrapper.mutable_setfieldresult();
     }
-    Socket::Send(wrapper);
 }
 
-static void GetField(GetField const& packet, uint64_t queryId) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(queryId);
+// the elements of an array read a chunk at a time, with the array kept alive until the last one
+struct ArrayChunks {
+    Il2CppArray* array;
+    std::uint32_t handle;
+    ProtoTypeInfo typeInfo;
+    std::size_t begin = 0;
+
+    ArrayChunks(Il2CppArray* array, ProtoTypeInfo typeInfo) :
+        array(array),
+        handle(array ? il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(array), false) : 0),
+        typeInfo(std::move(typeInfo)) {}
+    ~ArrayChunks() {
+        if (handle)
+            il2cpp_functions::gchandle_free(handle);
+    }
+    ArrayChunks(ArrayChunks const&) = delete;
+    ArrayChunks& operator=(ArrayChunks const&) = delete;
+};
+
+static void StreamArrayField(FieldInfo const* field, GetField const& packet, PacketWrapper& wrapper, Socket::Connection const& connection) {
+    auto chunks = std::make_shared<ArrayChunks>(FieldUtils::GetArray(field, packet.inst()), GetTypeInfo(field->type));
+    std::size_t chunkSize = packet.chunksize();
+    LOG_DEBUG("Streaming array field {} of length {}", packet.fieldid(), chunks->array ? chunks->array->max_length : 0);
+
+    StreamChunks(wrapper, connection, [chunks, chunkSize](PacketWrapper& chunk) {
+        std::size_t length = chunks->array ? chunks->array->max_length : 0;
+        auto end = std::min(chunks->begin + chunkSize, length);
+        auto& value = *chunk.mutable_getfieldresult()->mutable_value();
+        if (chunks->begin == 0)
+            *value.mutable_typeinfo() = chunks->typeInfo;
+        *value.mutable_data() = OutputArray(chunks->typeInfo.arrayinfo(), chunks->array, chunks->begin, end);
+        chunks->begin = end;
+        return end >= length;
+    });
+}
 
+static void GetField(GetField const& packet, PacketWrapper& wrapper, Socket::Connection const* stream) {
     auto field = asPtr(FieldInfo, packet.fieldid());
 
     if (!TryValidatePtr(field))
         INPUT_ERROR("field info pointer was invalid")
+    else if (stream && packet.chunksize() > 0 && field->type->type == IL2CPP_TYPE_SZARRAY)
+        StreamArrayField(field, packet, wrapper, *stream);
     else {
         LOG_DEBUG("Getting field {}", packet.fieldid());
 
-        auto res = FieldUtils::Get(field, packet.inst());
-
         GetFieldResult& result = *wrapper.mutable_getfieldresult();
-        *result.mutable_value() = res;
+        *result.mutable_value() = FieldUtils::Get(field, packet.inst());
     }
-    Socket::Send(wrapper);
 }
 
-static void InvokeMethod(InvokeMethod const& packet, uint64_t queryId) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(queryId);
+// the method made with the generic classes, or null with error set if one of them was invalid
+static MethodInfo const* MakeGenericMethod(
+    MethodInfo const* method, google::protobuf::RepeatedPtrField<ProtoTypeInfo> const& generics, std::string& error
+) {
+    if (generics.empty())
+        return method;
+    std::vector<Il2CppClass*> classes{};
+    for (auto const& generic : generics) {
+        auto clazz = GetClass(generic);
+        if (!clazz) {
+            error = fmt::format("generic {} was invalid", generic.ShortDebugString());
+            return nullptr;
+        }
+        classes.push_back(clazz);
+    }
+    return il2cpp_utils::MakeGenericMethod(method, classes);
+}
 
+static void InvokeMethod(InvokeMethod const& packet, PacketWrapper& wrapper) {
     auto method = asPtr(MethodInfo const, packet.methodid());
 
+    std::string error;
     if (!TryValidatePtr(method))
         INPUT_ERROR("method info pointer was invalid")
+    else if (method = MakeGenericMethod(method, packet.generics(), error); !method)
+        INPUT_ERROR("{}", error)
     else {
-        bool validGenerics = true;
-        if (int size = packet.generics_size()) {
-            std::vector<Il2CppClass*> generics{};
-            for (int i = 0; i < size; i++) {
-                auto clazz = GetClass(packet.generics(i));
-                if (!clazz) {
-                    INPUT_ERROR("generic {} was invalid", packet.generics(i).ShortDebugString())
-                    validGenerics = false;
-                    break;
-                } else
-                    generics.push_back(clazz);
-            }
-            if (validGenerics)
-                method = il2cpp_utils::MakeGenericMethod(method, generics);
+        std::vector<ProtoDataPayload> args{};
+        for (int i = 0; i < packet.args_size(); i++)
+            args.emplace_back(packet.args(i));
+
+        auto ret = MethodUtils::Run(method, packet.inst(), args);
+
+        InvokeMethodResult& result = *wrapper.mutable_invokemethodresult();
+
+        if (!ret.error.empty()) {
+            result.set_status(InvokeMethodResult::ERR);
+            result.set_error(ret.error);
+            return;
         }
-        if (validGenerics) {
-            std::vector<ProtoDataPayload> args{};
-            for (int i = 0; i < packet.args_size(); i++)
-                args.emplace_back(packet.args(i));
 
-            auto ret = MethodUtils::Run(method, packet.inst(), args);
+        result.set_status(InvokeMethodResult::OK);
+        if (ret.self)
+            *result.mutable_self() = *ret.self;
+        *result.mutable_result() = ret.result;
+        result.mutable_byrefchanges()->insert(ret.byrefs.begin(), ret.byrefs.end());
+    }
+}
 
-            InvokeMethodResult& result = *wrapper.mutable_invokemethodresult();
+// the payload a value refers to, or null if it is the result of a step that hasn't run yet
+static ProtoDataPayload const* GetStepValue(InvokePipeline::Value const& value, std::vector<ProtoDataPayload> const& results) {
+    if (value.has_step())
+        return value.step() < results.size() ? &results[value.step()] : nullptr;
+    return &value.payload();
+}
 
-            if (!ret.error.empty()) {
-                result.set_status(InvokeMethodResult::ERR);
-                result.set_error(ret.error);
-                Socket::Send(wrapper);
-                return;
-            }
+// keeps the objects returned by steps from being collected before the steps after them use them
+struct PinnedResults {
+    std::vector<std::uint32_t> handles;
+
+    void Add(ProtoDataPayload const& value) {
+        auto const& data = value.data();
+        if (data.Data_case() == ProtoDataSegment::kClassData && data.classdata() != 0)
+            handles.push_back(il2cpp_functions::gchandle_new(asPtr(Il2CppObject, data.classdata()), false));
+    }
+    ~PinnedResults() {
+        for (auto handle : handles)
+            il2cpp_functions::gchandle_free(handle);
+    }
+};
 
-            result.set_status(InvokeMethodResult::OK);
-            if (ret.self)
-                *result.mutable_self() = *ret.self;
-            *result.mutable_result() = ret.result;
-            result.mutable_byrefchanges()->insert(ret.byrefs.begin(), ret.byrefs.end());
+static ProtoDataPayload RunStep(InvokePipeline::Step const& step, std::vector<ProtoDataPayload>& results, std::string& error) {
+    auto inst = step.has_inst() ? GetStepValue(step.inst(), results) : &ProtoDataPayload::default_instance();
+    if (!inst) {
+        error = "instance was the result of a later step";
+        return {};
+    }
+    std::vector<ProtoDataPayload> args;
+    for (auto const& arg : step.args()) {
+        auto value = GetStepValue(arg, results);
+        if (!value) {
+            error = "argument was the result of a later step";
+            return {};
         }
+        args.emplace_back(*value);
+    }
+    auto instCase = inst->data().Data_case();
+    // sets error if the member isn't static and can't be used with the instance
+    auto checkInst = [&](bool isStatic, char const* member) {
+        if (isStatic)
+            return true;
+        if (instCase == ProtoDataSegment::DATA_NOT_SET)
+            error = fmt::format("{} needs an instance", member);
+        else if (instCase == ProtoDataSegment::kClassData && inst->data().classdata() == 0)
+            error = "instance was null";
+        return error.empty();
+    };
+
+    switch (step.Member_case()) {
+        case InvokePipeline::Step::kMethodId: {
+            auto method = asPtr(MethodInfo const, step.methodid());
+            if (!TryValidatePtr(method) || !(method = MakeGenericMethod(method, step.generics(), error))) {
+                if (error.empty())
+                    error = "method info pointer was invalid";
+                return {};
+            }
+            if (!checkInst(GetIsStatic(method), "method"))
+                return {};
+            auto ret = MethodUtils::Run(method, *inst, args);
+            error = std::move(ret.error);
+            // a struct instance is a copy, so changes the method made to it are kept in the step it came from
+            if (error.empty() && ret.self && step.inst().has_step())
+                *results[step.inst().step()].mutable_data() = std::move(*ret.self);
+            return std::move(ret.result);
+        }
+        case InvokePipeline::Step::kGetFieldId: {
+            auto field = asPtr(FieldInfo const, step.getfieldid());
+            if (!TryValidatePtr(field))
+                error = "field info pointer was invalid";
+            else if (checkInst(GetIsStatic(field), "field"))
+                return FieldUtils::Get(field, *inst);
+            return {};
+        }
+        case InvokePipeline::Step::kSetFieldId: {
+            auto field = asPtr(FieldInfo const, step.setfieldid());
+            if (!TryValidatePtr(field))
+                error = "field info pointer was invalid";
+            else if (GetIsLiteral(field))
+                error = "literal fields cannot be set";
+            else if (!checkInst(GetIsStatic(field), "field"))
+                return {};
+            else if (!GetIsStatic(field) && instCase == ProtoDataSegment::kStructData)
+                error = "fields of a struct instance cannot be set, as it is a copy";
+            else if (args.size() != 1)
+                error = "setting a field needs one value";
+            else
+                FieldUtils::Set(field, *inst, args.front());
+            return {};
+        }
+        default:
+            error = "step has no member";
+            return {};
     }
-    Socket::Send(wrapper);
 }
 
-static void SearchObjects(SearchObjects const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+static void InvokePipeline(InvokePipeline const& packet, PacketWrapper& wrapper) {
+    auto& result = *wrapper.mutable_invokepipelineresult();
+
+    std::vector<ProtoDataPayload> results;
+    results.reserve(packet.steps_size());
+    PinnedResults pinned;
+    for (int i = 0; i < packet.steps_size(); i++) {
+        auto const& step = packet.steps(i);
+        std::string error;
+        auto value = RunStep(step, results, error);
+        if (!error.empty()) {
+            LOG_INFO("pipeline step {} failed: {}", i, error);
+            result.set_failedstep(i);
+            result.set_error(error);
+            break;
+        }
+        pinned.Add(value);
+        results.emplace_back(std::move(value));
+    }
+    // outputs are filled once the steps have run, since a later method on a struct result changes it
+    for (int i = 0; i < results.size(); i++) {
+        if (!packet.steps(i).output())
+            continue;
+        auto& output = *result.add_outputs();
+        output.set_step(i);
+        *output.mutable_value() = std::move(results[i]);
+    }
+}
 
+static void SearchObjects(SearchObjects const& packet, PacketWrapper& wrapper) {
     std::string name = packet.has_name() ? packet.name() : "";
 
     Il2CppClass* clazz = GetClass(packet.componentclass());
     if (!clazz) {
         INPUT_ERROR("Could not find class {}", packet.componentclass().DebugString())
-        Socket::Send(wrapper);
         return;
     }
 
-    *wrapper.mutable_searchobjectsresult() = FindObjects(clazz, name);
+    FindObjects(clazz, name, *wrapper.mutable_searchobjectsresult());
+}
 
-    Socket::Send(wrapper);
+static void QueryGameObjects(QueryGameObjects const& packet, PacketWrapper& wrapper) {
+    Il2CppClass* component = nullptr;
+    if (packet.has_component() && !(component = GetClass(packet.component()))) {
+        INPUT_ERROR("Could not find class {}", packet.component().DebugString())
+        return;
+    }
+    // GetComponent throws for anything else, which nothing on the main thread would catch
+    if (component && !il2cpp_functions::class_is_interface(component) &&
+        !il2cpp_functions::class_is_assignable_from(classof(UnityEngine::Component*), component)) {
+        INPUT_ERROR("{} is not a component or interface", packet.component().DebugString())
+        return;
+    }
+
+    try {
+        FilterGameObjects(packet, component, *wrapper.mutable_querygameobjectsresult());
+    } catch (std::regex_error const& error) {
+        wrapper.clear_querygameobjectsresult();
+        INPUT_ERROR("invalid regex: {}", error.what())
+    }
 }
 
-static void GetAllGameObjects(GetAllGameObjects const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+static void GetAllGameObjects(GetAllGameObjects const& packet, PacketWrapper& wrapper, Socket::Connection const* stream) {
+    auto since = packet.has_sincegeneration() ? std::optional(packet.sincegeneration()) : std::nullopt;
+    if (!stream || packet.chunksize() == 0) {
+        FindAllGameObjects(*wrapper.mutable_getallgameobjectsresult(), since);
+        return;
+    }
+    auto hierarchy = std::make_shared<HierarchyStream>(since);
+    StreamChunks(wrapper, *stream, [hierarchy, chunkSize = packet.chunksize()](PacketWrapper& chunk) {
+        return hierarchy->Next(chunkSize, *chunk.mutable_getallgameobjectsresult());
+    });
+}
 
-    *wrapper.mutable_getallgameobjectsresult() = FindAllGameObjects();
+static void GetChildren(GetChildren const& packet, PacketWrapper& wrapper) {
+    auto transform = asPtr(UnityEngine::Transform, packet.transform());
 
-    Socket::Send(wrapper);
+    if (!TryValidatePtr(transform))
+        INPUT_ERROR("transform pointer was invalid")
+    else
+        FindChildren(transform, packet.offset(), packet.limit(), packet.depth(), *wrapper.mutable_getchildrenresult());
 }
 
-static void GetGameObjectComponents(GetGameObjectComponents const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+static void GetSceneRoots(GetSceneRoots const& packet, PacketWrapper& wrapper) {
+    auto scene = packet.has_scene() ? std::optional(packet.scene()) : std::nullopt;
+    FindSceneRoots(scene, packet.offset(), packet.limit(), *wrapper.mutable_getscenerootsresult());
+}
 
+static void GetGameObjectComponents(GetGameObjectComponents const& packet, PacketWrapper& wrapper) {
     auto gameObject = asPtr(UnityEngine::GameObject, packet.address());
 
     if (!TryValidatePtr(gameObject))
         INPUT_ERROR("gameObject pointer was invalid")
     else
-        *wrapper.mutable_getgameobjectcomponentsresult() = GetComponents(gameObject);
-
-    Socket::Send(wrapper);
+        GetComponents(gameObject, *wrapper.mutable_getgameobjectcomponentsresult());
 }
 
-static void CreateObject(CreateObject const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
-
+static void CreateObject(CreateObject const& packet, PacketWrapper& wrapper) {
     auto clazz = GetClass(packet.clazz());
     if (!clazz)
         INPUT_ERROR("class was invalid")
@@ -176,14 +443,9 @@ static void CreateObject(CreateObject const& packet, uint64_t id) {
         auto object = il2cpp_functions::object_new(clazz);
         wrapper.mutable_createobjectresult()->set_address(asInt(object));
     }
-
-    Socket::Send(wrapper);
 }
 
-static void ReadMemory(ReadMemory const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
-
+static void ReadMemory(ReadMemory const& packet, PacketWrapper& wrapper) {
     auto src = asPtr(void, packet.address());
 
     if (!TryValidatePtr(src))
@@ -192,8 +454,9 @@ static void ReadMemory(ReadMemory const& packet, uint64_t id) {
         ReadMemoryResult& result = *wrapper.mutable_readmemoryresult();
         result.set_address(packet.address());
 
-        auto size = packet.size();
-        if (mem::protect(src, size, mem::protection::read_write_execute)) {
+        // only the readable start of the range is returned, without changing any protections
+        auto size = mem::readable(src, packet.size());
+        if (!size) {
             result.set_status(ReadMemoryResult_Status::ReadMemoryResult_Status_ERR);
         } else {
             result.set_status(ReadMemoryResult_Status::ReadMemoryResult_Status_OK);
@@ -201,13 +464,9 @@ static void ReadMemory(ReadMemory const& packet, uint64_t id) {
         }
         LOG_DEBUG("Result is {}", wrapper.DebugString());
     }
-    Socket::Send(wrapper);
 }
 
-static void WriteMemory(WriteMemory const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
-
+static void WriteMemory(WriteMemory const& packet, PacketWrapper& wrapper) {
     auto dst = asPtr(void, packet.address());
 
     if (!TryValidatePtr(dst))
@@ -227,87 +486,132 @@ static void WriteMemory(WriteMemory const& packet, uint64_t id) {
         }
         LOG_DEBUG("Result is {}", wrapper.DebugString());
     }
-    Socket::Send(wrapper);
 }
 
-std::unordered_map<Il2CppClass const*, ProtoClassDetails> cachedClasses;
-
-ProtoClassDetails GetClassDetailsCached(Il2CppClass* clazz) {
-    if (clazz == nullptr)
-        return ProtoClassDetails();  // don't add to cache
+// each class's own members, without its parent's, which are shared through the link instead of copied
+struct ClassNode {
+    ProtoClassDetails details;
+    std::shared_ptr<ClassNode const> parent;
+};
+
+// details can be requested from the main thread and the workers at once
+// evicted nodes stay alive for as long as a cached child still links to them, outside of the budget
+ShardedCache<Il2CppClass const*, std::shared_ptr<ClassNode const>> cachedClasses(32 * 1024 * 1024);
+
+// every node that is still alive, cached or not, so an evicted parent still linked to is used again instead of duplicated
+static std::shared_mutex liveClassesMutex;
+static std::unordered_map<Il2CppClass const*, std::weak_ptr<ClassNode const>> liveClasses;
+// the size after expired entries were last cleared out
+static std::size_t liveClassesPruned = 0;
+
+static std::shared_ptr<ClassNode const> FindLiveClass(Il2CppClass const* clazz) {
+    std::shared_lock lock(liveClassesMutex);
+    auto found = liveClasses.find(clazz);
+    return found == liveClasses.end() ? nullptr : found->second.lock();
+}
 
-    auto cached = cachedClasses.find(clazz);
-    if (cached != cachedClasses.end()) {
-        LOG_DEBUG("Returning cached details for {}::{}", il2cpp_functions::class_get_namespace(clazz), il2cpp_functions::class_get_name(clazz));
-        return cached->second;
+static void AddLiveClass(Il2CppClass const* clazz, std::shared_ptr<ClassNode const> const& node) {
+    std::unique_lock lock(liveClassesMutex);
+    liveClasses[clazz] = node;
+    if (liveClasses.size() > 2 * liveClassesPruned + 1024) {
+        std::erase_if(liveClasses, [](auto const& pair) { return pair.second.expired(); });
+        liveClassesPruned = liveClasses.size();
     }
+}
 
-    ProtoClassDetails ret;
+static void FillOwnDetails(Il2CppClass const* clazz, ProtoClassDetails& details) {
+    LOG_DEBUG("Finding class details for {}::{}", il2cpp_functions::class_get_namespace(clazz), il2cpp_functions::class_get_name(clazz));
+    *details.mutable_clazz() = GetClassInfo(typeofclass(clazz));
 
-    auto const* currentClass = clazz;
-    auto currentClassProto = &ret;
+    for (auto f : GetFields(clazz)) {
+        if (GetIsStatic(f))
+            *details.add_staticfields() = FieldUtils::GetFieldInfo(f);
+        else
+            *details.add_fields() = FieldUtils::GetFieldInfo(f);
+    }
 
-    // Use a while loop instead of recursive
-    // method to improve stack allocations
-    while (currentClass != nullptr) {
-        LOG_DEBUG(
-            "Finding class details for {}::{}", il2cpp_functions::class_get_namespace(currentClass), il2cpp_functions::class_get_name(currentClass)
-        );
-        *currentClassProto->mutable_clazz() = GetClassInfo(typeofclass(currentClass));
+    std::set<MethodInfo const*> propertyMethods = {};
+    for (auto p : GetProperties(clazz)) {
+        propertyMethods.insert(p->get);
+        propertyMethods.insert(p->set);
+        if (GetIsStatic(p))
+            *details.add_staticproperties() = MethodUtils::GetPropertyInfo(p);
+        else
+            *details.add_properties() = MethodUtils::GetPropertyInfo(p);
+    }
 
-        for (auto f : GetFields(currentClass)) {
-            if (GetIsStatic(f))
-                *currentClassProto->add_staticfields() = FieldUtils::GetFieldInfo(f);
-            else
-                *currentClassProto->add_fields() = FieldUtils::GetFieldInfo(f);
-        }
+    for (auto const& m : GetMethods(clazz)) {
+        if (propertyMethods.find(m) != propertyMethods.end())
+            continue;
+        if (GetIsStatic(m))
+            *details.add_staticmethods() = MethodUtils::GetMethodInfo(m);
+        else
+            *details.add_methods() = MethodUtils::GetMethodInfo(m);
+    }
 
-        std::set<MethodInfo const*> propertyMethods = {};
-        for (auto p : GetProperties(currentClass)) {
-            propertyMethods.insert(p->get);
-            propertyMethods.insert(p->set);
-            if (GetIsStatic(p))
-                *currentClassProto->add_staticproperties() = MethodUtils::GetPropertyInfo(p);
-            else
-                *currentClassProto->add_properties() = MethodUtils::GetPropertyInfo(p);
-        }
+    for (auto i : GetInterfaces(clazz))
+        *details.add_interfaces() = GetClassInfo(typeofclass(i));
+}
 
-        for (auto const& m : GetMethods(currentClass)) {
-            if (propertyMethods.find(m) != propertyMethods.end())
-                continue;
-            if (GetIsStatic(m))
-                *currentClassProto->add_staticmethods() = MethodUtils::GetMethodInfo(m);
-            else
-                *currentClassProto->add_methods() = MethodUtils::GetMethodInfo(m);
-        }
+// own details loaded by the metadata warm-up, which are used instead of finding them again
+using SavedDetails = std::unordered_map<Il2CppClass const*, ProtoClassDetails>;
 
-        for (auto i : GetInterfaces(currentClass))
-            *currentClassProto->add_interfaces() = GetClassInfo(typeofclass(i));
+static bool TakeSavedDetails(Il2CppClass const* clazz, SavedDetails* saved, ProtoClassDetails& details) {
+    if (!saved)
+        return false;
+    auto entry = saved->extract(clazz);
+    if (entry.empty())
+        return false;
+    details = std::move(entry.mapped());
+    return true;
+}
 
-        currentClass = GetParent(currentClass);
-        if (currentClass)
-            currentClassProto = currentClassProto->mutable_parent();
-    }
+std::shared_ptr<ClassNode const> GetClassDetailsCached(Il2CppClass const* clazz, SavedDetails* saved = nullptr) {
+    if (clazz == nullptr)
+        return nullptr;  // don't add to cache
 
-    // while loop means I can't add the parents to the cache in it
-    // because it goes in the wrong order, so parents aren't filled out when they would be added
-    currentClass = clazz;
-    currentClassProto = &ret;
+    // the cache is only checked for the class itself, so its hits and misses count requests
+    if (auto cached = cachedClasses.Find(clazz)) {
+        LOG_DEBUG("Returning cached details for {}::{}", il2cpp_functions::class_get_namespace(clazz), il2cpp_functions::class_get_name(clazz));
+        return *cached;
+    }
 
-    while (currentClass != nullptr) {
-        cachedClasses[currentClass] = *currentClassProto;
-        currentClass = GetParent(currentClass);
-        if (currentClass)
-            currentClassProto = currentClassProto->mutable_parent();
+    // only the classes up to the first live ancestor need to be found, which are then added from the top down
+    std::vector<Il2CppClass const*> missing;
+    std::shared_ptr<ClassNode const> parent;
+    for (auto current = clazz; current && !(parent = FindLiveClass(current)); current = GetParent(current))
+        missing.emplace_back(current);
+
+    // evicted but still linked to by a cached child, so it only has to be counted again
+    if (missing.empty())
+        return cachedClasses.Insert(clazz, parent, parent->details.SpaceUsedLong());
+
+    for (auto current = missing.rbegin(); current != missing.rend(); current++) {
+        // not make_shared, which would keep the whole node allocated for as long as its weak pointer is left in liveClasses
+        auto node = std::shared_ptr<ClassNode>(new ClassNode());
+        if (!TakeSavedDetails(*current, saved, node->details))
+            FillOwnDetails(*current, node->details);
+        node->parent = std::move(parent);
+        // another thread may have added it meanwhile, in which case theirs is used
+        parent = cachedClasses.Insert(*current, node, node->details.SpaceUsedLong());
+        AddLiveClass(*current, parent);
     }
 
-    return ret;
+    return parent;
 }
 
-static void FillTypeInfo(FillTypeInfo const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+// copies one level at a time, so the details of each class are only copied once
+static void FillClassDetails(ClassNode const* node, ProtoClassDetails& details) {
+    auto current = &details;
+    while (node) {
+        current->MergeFrom(node->details);
+        node = node->parent.get();
+        if (node)
+            current = current->mutable_parent();
+    }
+}
 
+static void FillTypeInfo(FillTypeInfo const& packet, PacketWrapper& wrapper) {
     auto result = wrapper.mutable_filltypeinforesult();
 
     Il2CppClass* clazz = GetClass(packet.clazz());
@@ -315,29 +619,19 @@ static void FillTypeInfo(FillTypeInfo const& packet, uint64_t id) {
         INPUT_ERROR("Could not find class {}", packet.clazz().DebugString())
     else
         *result->mutable_info() = GetTypeInfo(clazz);
-
-    Socket::Send(wrapper);
 }
 
-static void GetClassDetails(GetClassDetails const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
-
+static void GetClassDetails(GetClassDetails const& packet, PacketWrapper& wrapper) {
     auto result = wrapper.mutable_getclassdetailsresult();
 
     Il2CppClass* clazz = GetClass(packet.classinfo());
     if (!clazz)
         INPUT_ERROR("Could not find class {}", packet.classinfo().DebugString())
     else
-        *result->mutable_classdetails() = GetClassDetailsCached(clazz);
-
-    Socket::Send(wrapper);
+        FillClassDetails(GetClassDetailsCached(clazz).get(), *result->mutable_classdetails());
 }
 
-static void GetInstanceClass(GetInstanceClass const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
-
+static void GetInstanceClass(GetInstanceClass const& packet, PacketWrapper& wrapper) {
     auto instance = asPtr(Il2CppObject, packet.address());
 
     if (!TryValidatePtr(instance))
@@ -346,162 +640,1081 @@ static void GetInstanceClass(GetInstanceClass const& packet, uint64_t id) {
         auto result = wrapper.mutable_getinstanceclassresult();
         *result->mutable_classinfo() = GetClassInfo(typeofinst(instance));
     }
+}
+
+// plans only point to the members of their class, so they can be rebuilt at any time after eviction
+static ShardedCache<Il2CppClass const*, std::shared_ptr<AccessorPlan const>> accessorPlans(8 * 1024 * 1024);
 
-    Socket::Send(wrapper);
+static std::shared_ptr<AccessorPlan const> GetAccessorPlan(Il2CppClass const* clazz) {
+    if (clazz == nullptr)
+        return nullptr;
+    if (auto cached = accessorPlans.Find(clazz))
+        return *cached;
+
+    auto plan = std::make_shared<AccessorPlan>();
+    auto root = GetClassDetailsCached(clazz);
+    for (auto node = root.get(); node; node = node->parent.get()) {
+        auto& classDetails = node->details;
+        for (auto fields : {&classDetails.fields(), &classDetails.staticfields()}) {
+            for (auto const& field : *fields)
+                plan->AddField(field.id(), asPtr(FieldInfo const, field.id()));
+        }
+        for (auto properties : {&classDetails.properties(), &classDetails.staticproperties()}) {
+            for (auto const& prop : *properties) {
+                if (prop.has_getterid() && prop.getterid())
+                    plan->AddGetter(prop.id(), asPtr(MethodInfo const, prop.getterid()));
+            }
+        }
+    }
+    return accessorPlans.Insert(clazz, plan, plan->SpaceUsed());
 }
 
-static void AddFieldValue(ProtoDataPayload const& instance, ProtoFieldInfo const& field, GetInstanceValuesResult& ret) {
-    auto& value = *ret.add_values();
-    value.set_id(field.id());
-    auto fieldInfo = asPtr(FieldInfo, field.id());
-    *value.mutable_data() = FieldUtils::Get(fieldInfo, instance).data();
+#ifdef ACCESSOR_BENCHMARK
+// how values were read before accessor plans, resolving the instance and type again for each member
+static void ReadValuesPerMember(ProtoDataPayload const& instance, ClassNode const* node, GetInstanceValuesResult& ret) {
+    for (; node; node = node->parent.get()) {
+        auto& classDetails = node->details;
+        for (auto fields : {&classDetails.fields(), &classDetails.staticfields()}) {
+            for (auto const& field : *fields) {
+                auto& value = *ret.add_values();
+                value.set_id(field.id());
+                *value.mutable_data() = FieldUtils::Get(asPtr(FieldInfo const, field.id()), instance).data();
+            }
+        }
+        for (auto properties : {&classDetails.properties(), &classDetails.staticproperties()}) {
+            for (auto const& prop : *properties) {
+                if (!prop.has_getterid() || !prop.getterid())
+                    continue;
+                auto result = MethodUtils::Run(asPtr(MethodInfo const, prop.getterid()), instance, {});
+                if (!result.error.empty())
+                    continue;
+                auto& value = *ret.add_values();
+                value.set_id(prop.id());
+                *value.mutable_data() = std::move(*result.result.mutable_data());
+            }
+        }
+    }
 }
 
-static void AddPropertyValue(ProtoDataPayload const& instance, ProtoPropertyInfo const& prop, GetInstanceValuesResult& ret) {
-    if (!prop.has_getterid() || !prop.getterid())
+// times reading every loaded object of the class both ways, up to a few thousand of them
+static void BenchmarkAccessorPlan(Il2CppClass* clazz, ProtoTypeInfo const& type) {
+    static constexpr std::size_t maxObjects = 4096;
+    if (!clazz || !il2cpp_functions::class_is_assignable_from(classof(UnityEngine::Object*), clazz))
         return;
-    auto getter = asPtr(MethodInfo, prop.getterid());
-    auto result = MethodUtils::Run(getter, instance, {});
-    if (!result.error.empty())
-        LOG_ERROR("getting property failed with error: {}", result.error);
+    auto objects = UnityEngine::Object::FindObjectsOfType(reinterpret_cast<System::Type*>(il2cpp_utils::GetSystemType(clazz)), true);
+    std::vector<ProtoDataPayload> instances(std::min<std::size_t>(objects.size(), maxObjects));
+    for (std::size_t i = 0; i < instances.size(); i++) {
+        *instances[i].mutable_typeinfo() = type;
+        instances[i].mutable_data()->set_classdata(asInt(objects[i]));
+    }
+    if (instances.empty())
+        return;
+
+    auto plan = GetAccessorPlan(clazz);
+    auto node = GetClassDetailsCached(clazz);
+    auto measure = [&instances](auto&& read) {
+        GetInstanceValuesResult result;
+        std::size_t values = 0;
+        auto start = Stats::Clock::now();
+        for (auto const& instance : instances) {
+            result.Clear();
+            read(instance, result);
+            values += result.values_size();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Stats::Clock::now() - start).count();
+        return std::make_pair(elapsed, values);
+    };
+    auto readPlanned = [&plan](auto const& instance, auto& result) { plan->Read(instance, result); };
+    // an untimed pass first, so neither is slowed by touching the objects for the first time
+    measure(readPlanned);
+    auto [perMember, perMemberValues] = measure([&node](auto const& instance, auto& result) { ReadValuesPerMember(instance, node.get(), result); });
+    auto [planned, plannedValues] = measure(readPlanned);
+    LOG_INFO(
+        "read {} {} objects: per member {}us ({} values), accessor plan {}us ({} values)",
+        instances.size(),
+        il2cpp_functions::class_get_name(clazz),
+        perMember,
+        perMemberValues,
+        planned,
+        plannedValues
+    );
+}
+#endif
+
+static void GetInstanceValues(GetInstanceValues const& packet, PacketWrapper& wrapper) {
+    auto& instance = packet.instance();
+
+    if (instance.data().has_classdata() && !TryValidatePtr(asPtr(Il2CppObject, instance.data().classdata())))
+        INPUT_ERROR("instance pointer was invalid")
     else {
-        auto& valuePair = *ret.add_values();
-        valuePair.set_id(prop.id());
-        *valuePair.mutable_data() = result.result.data();
+        auto& result = *wrapper.mutable_getinstancevaluesresult();
+        if (auto plan = GetAccessorPlan(GetClass(instance.typeinfo())))
+            plan->Read(instance, result);
+#ifdef ACCESSOR_BENCHMARK
+        if (instance.typeinfo().has_classinfo())
+            BenchmarkAccessorPlan(GetClass(instance.typeinfo()), instance.typeinfo());
+#endif
+    }
+}
+
+static void AddSafePtrInfo(Il2CppObject* inst, GetSafePtrAddressesResult::AddressInfo& info) {
+    info.set_address(asInt(inst));
+    *info.mutable_clazz() = ClassUtils::GetClassInfo(typeofclass(inst->klass));
+}
+
+static void FillSafePtrList(PacketWrapper& wrapper) {
+    auto res = wrapper.mutable_getsafeptraddressesresult();
+    auto& addresses = *res->mutable_addresses();
+
+    auto objs = QRUE::MainThreadRunner::GetKeepAlive();
+    addresses.Reserve(objs.size());
+    for (auto const& inst : objs)
+        AddSafePtrInfo(inst, *addresses.Add());
+}
+
+static void AddSafePtrAddress(AddSafePtrAddress const& addPacket, PacketWrapper& wrapper) {
+    auto addr = asPtr(Il2CppObject, addPacket.address());
+
+    if (!addPacket.remove() && !TryValidatePtr(addr)) {
+        INPUT_ERROR("address was invalid")
+        return;
     }
+    auto res = wrapper.mutable_getsafeptraddressesresult();
+
+    PacketWrapper changed;
+    auto& change = *changed.mutable_safeptraddresseschanged();
+    if (addPacket.remove()) {
+        if (!QRUE::MainThreadRunner::RemoveKeepAlive(addr))
+            return;
+        change.add_removed(addPacket.address());
+    } else {
+        if (!QRUE::MainThreadRunner::AddKeepAlive(addr))
+            return;
+        AddSafePtrInfo(addr, *res->add_addresses());
+        *change.add_added() = res->addresses(0);
+    }
+    // only the change goes out, instead of the whole list each time
+    Socket::Send(changed, false);
+}
+
+static void GetTypeComplete(GetTypeComplete const& packet, PacketWrapper& wrapper) {
+    auto& res = *wrapper.mutable_gettypecompleteresult();
+    auto& list = *res.mutable_options();
+
+    auto found = ClassUtils::SearchClasses(packet);
+    list.Add(found.begin(), found.end());
 }
 
-static GetInstanceValuesResult GetInstanceValuesForDetails(ProtoDataPayload const& instance, ProtoClassDetails const* classDetails) {
-    GetInstanceValuesResult ret;
+// metadata replies never change for a class, so they are kept serialized and only need the query id added
+struct ReplyKey {
+    PacketWrapper::PacketCase type;
+    Il2CppClass const* clazz;
+    auto operator<=>(ReplyKey const&) const = default;
+};
 
-    while (classDetails) {
-        for (auto field : classDetails->fields())
-            AddFieldValue(instance, field, ret);
-        for (auto field : classDetails->staticfields())
-            AddFieldValue(instance, field, ret);
-        for (auto prop : classDetails->properties())
-            AddPropertyValue(instance, prop, ret);
-        for (auto prop : classDetails->staticproperties())
-            AddPropertyValue(instance, prop, ret);
-        if (!classDetails->has_parent())
+struct ReplyKeyHash {
+    std::size_t operator()(ReplyKey const& key) const { return std::hash<void const*>{}(key.clazz) ^ key.type; }
+};
+
+static ShardedCache<ReplyKey, std::shared_ptr<std::string const>, ReplyKeyHash> replyCache(32 * 1024 * 1024);
+
+static std::optional<ReplyKey> GetReplyKey(PacketWrapper const& packet) {
+    Il2CppClass const* clazz = nullptr;
+    switch (packet.Packet_case()) {
+        case PacketWrapper::kFillTypeInfo:
+            clazz = GetClass(packet.filltypeinfo().clazz());
             break;
-        classDetails = &classDetails->parent();
+        case PacketWrapper::kGetClassDetails:
+            clazz = GetClass(packet.getclassdetails().classinfo());
+            break;
+        default:
+            return std::nullopt;
     }
+    // invalid classes go through the handler for the error
+    if (!clazz)
+        return std::nullopt;
+    return ReplyKey{packet.Packet_case(), clazz};
+}
 
-    return ret;
+static void AppendVarint(std::string& out, std::uint64_t value) {
+    do {
+        out.push_back((value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+}
+
+// encodes a PacketWrapper by hand, with the queryResultId and the already serialized result in its oneof field
+static std::optional<std::string> FindCachedReply(ReplyKey const& key, std::uint64_t queryResultId) {
+    auto cached = replyCache.Find(key);
+    if (!cached)
+        return std::nullopt;
+
+    auto& result = **cached;
+    int field = key.type == PacketWrapper::kFillTypeInfo ? PacketWrapper::kFillTypeInfoResultFieldNumber
+                                                         : PacketWrapper::kGetClassDetailsResultFieldNumber;
+    std::string reply;
+    reply.reserve(result.size() + 24);
+    if (queryResultId) {
+        AppendVarint(reply, (PacketWrapper::kQueryResultIdFieldNumber << 3) | 0);
+        AppendVarint(reply, queryResultId);
+    }
+    AppendVarint(reply, (field << 3) | 2);
+    AppendVarint(reply, result.size());
+    reply.append(result);
+    return reply;
+}
+
+static void CacheReply(ReplyKey const& key, PacketWrapper const& wrapper) {
+    std::string result;
+    if (wrapper.has_filltypeinforesult())
+        wrapper.filltypeinforesult().SerializeToString(&result);
+    else if (wrapper.has_getclassdetailsresult())
+        wrapper.getclassdetailsresult().SerializeToString(&result);
+    else
+        return;
+
+    auto bytes = result.size();
+    replyCache.Insert(key, std::make_shared<std::string const>(std::move(result)), bytes);
+}
+
+static void FillCacheStats(CacheStats const& stats, ProtoCacheStats& result) {
+    result.set_entries(stats.entries);
+    result.set_bytes(stats.bytes);
+    result.set_budget(stats.budget);
+    result.set_hits(stats.hits);
+    result.set_misses(stats.misses);
+    result.set_evictions(stats.evictions);
+}
+
+// a watched instance, only used on the main thread where watches are added, removed and read
+struct ValueWatch {
+    Socket::Connection connection;
+    std::uint64_t id;
+    ProtoDataPayload instance;
+    std::shared_ptr<AccessorPlan const> plan;
+    std::uint32_t interval;
+    std::uint64_t nextFrame;
+    // keeps the watched object from being collected
+    std::uint32_t handle;
+    // hashes of the last values sent, by id
+    std::unordered_map<std::uint64_t, std::size_t> sent;
+};
+
+static std::vector<ValueWatch> watches;
+static std::atomic<std::size_t> watchCount = 0;
+static std::atomic<std::chrono::microseconds> watchBudget = std::chrono::microseconds(1000);
+static std::uint64_t watchFrame = 0;
+// where the last frame stopped, so watches left over by the budget go first in the next
+static std::size_t nextWatch = 0;
+
+static std::size_t HashValue(ProtoDataSegment const& data) {
+    // struct data is a map, which is only serialized in the same order when deterministic
+    std::string serialized;
+    {
+        google::protobuf::io::StringOutputStream output(&serialized);
+        google::protobuf::io::CodedOutputStream coded(&output);
+        coded.SetSerializationDeterministic(true);
+        data.SerializeToCodedStream(&coded);
+    }
+    return std::hash<std::string>{}(serialized);
+}
+
+using ValueHashes = std::vector<std::pair<std::uint64_t, std::size_t>>;
+
+// moves the values that changed since they were last sent into result, with their hashes in changed
+static void DiffValues(ValueWatch const& watch, GetInstanceValuesResult& values, WatchResult& result, ValueHashes& changed) {
+    for (auto& pair : *values.mutable_values()) {
+        auto hash = HashValue(pair.data());
+        auto last = watch.sent.find(pair.id());
+        if (last != watch.sent.end() && last->second == hash)
+            continue;
+        changed.emplace_back(pair.id(), hash);
+        *result.add_values() = std::move(pair);
+    }
 }
 
-static void GetInstanceValues(GetInstanceValues const& packet, uint64_t id) {
+// only once the values are queued, so ones that weren't sent are still different next time
+static void SetSent(ValueWatch& watch, ValueHashes const& changed) {
+    for (auto [id, hash] : changed)
+        watch.sent[id] = hash;
+}
+
+static void ReadWatch(ValueWatch& watch) {
+    GetInstanceValuesResult values;
+    watch.plan->Read(watch.instance, values);
+
     PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+    wrapper.set_queryresultid(watch.id);
+    ValueHashes changed;
+    DiffValues(watch, values, *wrapper.mutable_watchresult(), changed);
+    if (!changed.empty() && Socket::Send(std::move(wrapper), watch.connection))
+        SetSent(watch, changed);
+}
+
+static void RemoveWatch(std::size_t index) {
+    il2cpp_functions::gchandle_free(watches[index].handle);
+    watches.erase(watches.begin() + index);
+    watchCount = watches.size();
+}
+
+// reads the watches that are due until the budget runs out, dropping those whose connection closed
+static void ReadWatches() {
+    watchFrame++;
+    if (watches.empty())
+        return;
+
+    auto budget = watchBudget.load();
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t remaining = watches.size(); remaining > 0 && !watches.empty(); remaining--) {
+        if (budget.count() > 0 && std::chrono::steady_clock::now() - start >= budget)
+            break;
+        nextWatch %= watches.size();
+        auto& watch = watches[nextWatch];
+        if (watch.connection.expired()) {
+            RemoveWatch(nextWatch);
+            continue;
+        }
+        // watches the budget didn't reach stay due, and are read as soon as they are reached
+        // as do ones for a connection that is behind, which are diffed against what was last sent once it catches up
+        if (watch.nextFrame <= watchFrame && !Socket::IsBackedUp(watch.connection)) {
+            ReadWatch(watch);
+            watch.nextFrame = watchFrame + watch.interval;
+        }
+        nextWatch++;
+    }
+}
 
+static void Watch(Watch const& packet, PacketWrapper& wrapper, Socket::Connection const* connection) {
     auto& instance = packet.instance();
+    auto object = asPtr(Il2CppObject, instance.data().classdata());
 
-    if (instance.data().has_classdata() && !TryValidatePtr(asPtr(Il2CppObject, instance.data().classdata())))
+    if (!connection)
+        INPUT_ERROR("watches cannot be batched")
+    else if (!instance.data().has_classdata())
+        INPUT_ERROR("only class instances can be watched, as structs are copies")
+    else if (!TryValidatePtr(object))
         INPUT_ERROR("instance pointer was invalid")
+    else if (auto plan = GetAccessorPlan(GetClass(instance.typeinfo())); !plan)
+        INPUT_ERROR("Could not find class {}", instance.typeinfo().DebugString())
     else {
-        auto clazz = GetClass(instance.typeinfo());
-        auto details = GetClassDetailsCached(clazz);
-        *wrapper.mutable_getinstancevaluesresult() = GetInstanceValuesForDetails(instance, &details);
+        if (packet.ids_size() > 0)
+            plan = std::make_shared<AccessorPlan const>(plan->Select({packet.ids().begin(), packet.ids().end()}));
+        auto interval = std::max(packet.frameinterval(), 1u);
+        auto handle = il2cpp_functions::gchandle_new(object, false);
+        watches.push_back({*connection, wrapper.queryresultid(), instance, plan, interval, watchFrame + interval, handle});
+        auto& watch = watches.back();
+        watchCount = watches.size();
+
+        // the reply is never dropped, and if the connection closes the watch goes with it
+        GetInstanceValuesResult values;
+        plan->Read(instance, values);
+        ValueHashes changed;
+        DiffValues(watch, values, *wrapper.mutable_watchresult(), changed);
+        SetSent(watch, changed);
     }
-    Socket::Send(wrapper);
 }
 
-static void SendSafePtrList(uint64_t id);
-
-static void AddSafePtrAddress(AddSafePtrAddress const& addPacket, uint64_t id) {
-    auto addr = asPtr(Il2CppObject, addPacket.address());
-    if (addPacket.remove())
-        QRUE::MainThreadRunner::RemoveKeepAlive(addr);
-    else
-        QRUE::MainThreadRunner::AddKeepAlive(addr);
-    SendSafePtrList(id);
+static void Unwatch(Unwatch const& packet, PacketWrapper& wrapper, Socket::Connection const* connection) {
+    if (!connection) {
+        INPUT_ERROR("watches cannot be batched")
+        return;
+    }
+    auto& result = *wrapper.mutable_unwatchresult();
+    auto owner = connection->lock();
+    for (std::size_t i = 0; i < watches.size(); i++) {
+        if (watches[i].id == packet.watchid() && watches[i].connection.lock() == owner) {
+            RemoveWatch(i);
+            result.set_removed(true);
+            return;
+        }
+    }
 }
 
-static void SendSafePtrList(uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+static void FillFrameStats(FrameBudgetResult& result) {
+    auto stats = QRUE::MainThreadRunner::GetFrameStats();
+    result.set_budgetmicros(QRUE::MainThreadRunner::GetFrameBudget().count());
+    result.set_frames(stats.frames);
+    result.set_overbudgetframes(stats.overBudget);
+    result.set_worstoverrunmicros(stats.worstOverrun.count());
+    result.set_carried(stats.carried);
+    result.set_watchbudgetmicros(watchBudget.load().count());
+    result.set_watches(watchCount);
+}
 
-    auto res = wrapper.mutable_getsafeptraddressesresult();
-    auto& addresses = *res->mutable_addresses();
+static void FrameBudget(FrameBudget const& packet, PacketWrapper& wrapper) {
+    if (packet.has_budgetmicros())
+        QRUE::MainThreadRunner::SetFrameBudget(std::chrono::microseconds(packet.budgetmicros()));
+    if (packet.has_watchbudgetmicros())
+        watchBudget = std::chrono::microseconds(packet.watchbudgetmicros());
 
-    auto objs = QRUE::MainThreadRunner::GetInstance()->keepAliveObjects;
-    for (auto const& inst : objs) {
-        auto& info = *addresses.Add();
-        info.set_address(asInt(inst));
-        *info.mutable_clazz() = ClassUtils::GetClassInfo(typeofclass(inst->klass));
-    }
+    FillFrameStats(*wrapper.mutable_framebudgetresult());
+}
 
-    Socket::Send(wrapper);
+static void CacheBudget(CacheBudget const& packet, PacketWrapper& wrapper) {
+    if (packet.has_typeinfobytes())
+        ClassUtils::SetTypeInfoCacheBudget(packet.typeinfobytes());
+    if (packet.has_classdetailsbytes())
+        cachedClasses.SetBudget(packet.classdetailsbytes());
+    if (packet.has_replybytes())
+        replyCache.SetBudget(packet.replybytes());
+
+    auto& result = *wrapper.mutable_cachebudgetresult();
+    FillCacheStats(ClassUtils::GetTypeInfoCacheStats(), *result.mutable_typeinfocache());
+    FillCacheStats(cachedClasses.GetStats(), *result.mutable_classdetailscache());
+    FillCacheStats(replyCache.GetStats(), *result.mutable_replycache());
 }
 
-static void GetTypeComplete(GetTypeComplete const& packet, uint64_t id) {
-    PacketWrapper wrapper;
-    wrapper.set_queryresultid(id);
+static void SendSettings(SendSettings const& packet, PacketWrapper& wrapper) {
+    if (packet.has_compressionthreshold())
+        Socket::SetCompressionThreshold(packet.compressionthreshold());
 
-    auto& res = *wrapper.mutable_gettypecompleteresult();
-    auto& list = *res.mutable_options();
+    wrapper.mutable_sendsettingsresult()->set_compressionthreshold(Socket::GetCompressionThreshold());
+}
 
-    auto found = ClassUtils::SearchClasses(packet);
-    list.Add(found.begin(), found.end());
+static void GetServerStats(GetServerStats const& packet, PacketWrapper& wrapper) {
+    auto& result = *wrapper.mutable_getserverstatsresult();
+
+    Stats::Fill(result);
+    if (packet.reset())
+        Stats::Reset();
+
+    for (auto const& peer : Socket::GetStats()) {
+        auto& stats = *result.add_peers();
+        stats.set_queued(peer.queued);
+        stats.set_peakqueued(peer.peakQueued);
+        stats.set_buffered(peer.buffered);
+        stats.set_sent(peer.sent);
+        stats.set_bytes(peer.bytes);
+        stats.set_compressed(peer.compressed);
+        stats.set_dropped(peer.dropped);
+        stats.set_coalesced(peer.coalesced);
+        stats.set_stalls(peer.stalls);
+        stats.set_readpauses(peer.readPauses);
+    }
+
+    FillFrameStats(*result.mutable_frames());
 
-    Socket::Send(wrapper);
+    FillCacheStats(ClassUtils::GetTypeInfoCacheStats(), *result.mutable_typeinfocache());
+    FillCacheStats(cachedClasses.GetStats(), *result.mutable_classdetailscache());
+    FillCacheStats(replyCache.GetStats(), *result.mutable_replycache());
+    FillCacheStats(accessorPlans.GetStats(), *result.mutable_accessorplancache());
 }
 
-void Manager::ProcessMessage(PacketWrapper const& packet) {
-    LOG_DEBUG("processing packet: {}", packet.DebugString());
-    auto id = packet.queryresultid();
+static bool HandlePacket(PacketWrapper const& packet, PacketWrapper& wrapper, Socket::Connection const* stream);
+
+static void RunBatch(Batch const& packet, PacketWrapper& wrapper) {
+    LOG_DEBUG("Running batch of {} requests", packet.requests_size());
 
+    auto& results = *wrapper.mutable_batchresult()->mutable_results();
+    results.Reserve(packet.requests_size());
+    for (auto const& request : packet.requests()) {
+        auto& result = *results.Add();
+        result.set_queryresultid(request.queryresultid());
+        if (request.has_batch())
+            result.set_inputerror("batches cannot be nested");
+        else if (!HandlePacket(request, result, nullptr))
+            result.set_inputerror(fmt::format("invalid packet type {}", (int) request.Packet_case()));
+    }
+}
+
+// fills wrapper with the result of packet, or returns false if it isn't a valid request
+// results are only streamed when stream is given, otherwise they are returned whole
+// watches also need stream, as the connection their values are pushed to
+static bool HandlePacket(PacketWrapper const& packet, PacketWrapper& wrapper, Socket::Connection const* stream) {
     switch (packet.Packet_case()) {
         case PacketWrapper::kInvokeMethod:
-            InvokeMethod(packet.invokemethod(), id);
+            InvokeMethod(packet.invokemethod(), wrapper);
+            break;
+        case PacketWrapper::kInvokePipeline:
+            InvokePipeline(packet.invokepipeline(), wrapper);
             break;
         case PacketWrapper::kSetField:
-            SetField(packet.setfield(), id);
+            SetField(packet.setfield(), wrapper);
             break;
         case PacketWrapper::kGetField:
-            GetField(packet.getfield(), id);
+            GetField(packet.getfield(), wrapper, stream);
             break;
         case PacketWrapper::kSearchObjects:
-            SearchObjects(packet.searchobjects(), id);
+            SearchObjects(packet.searchobjects(), wrapper);
+            break;
+        case PacketWrapper::kQueryGameObjects:
+            QueryGameObjects(packet.querygameobjects(), wrapper);
             break;
         case PacketWrapper::kGetAllGameObjects:
-            GetAllGameObjects(packet.getallgameobjects(), id);
+            GetAllGameObjects(packet.getallgameobjects(), wrapper, stream);
+            break;
+        case PacketWrapper::kGetChildren:
+            GetChildren(packet.getchildren(), wrapper);
+            break;
+        case PacketWrapper::kGetSceneRoots:
+            GetSceneRoots(packet.getsceneroots(), wrapper);
             break;
         case PacketWrapper::kGetGameObjectComponents:
-            GetGameObjectComponents(packet.getgameobjectcomponents(), id);
+            GetGameObjectComponents(packet.getgameobjectcomponents(), wrapper);
             break;
         case PacketWrapper::kReadMemory:
-            ReadMemory(packet.readmemory(), id);
+            ReadMemory(packet.readmemory(), wrapper);
             break;
         case PacketWrapper::kWriteMemory:
-            WriteMemory(packet.writememory(), id);
+            WriteMemory(packet.writememory(), wrapper);
             break;
         case PacketWrapper::kFillTypeInfo:
-            FillTypeInfo(packet.filltypeinfo(), id);
+            FillTypeInfo(packet.filltypeinfo(), wrapper);
             break;
         case PacketWrapper::kGetClassDetails:
-            GetClassDetails(packet.getclassdetails(), id);
+            GetClassDetails(packet.getclassdetails(), wrapper);
             break;
         case PacketWrapper::kGetInstanceClass:
-            GetInstanceClass(packet.getinstanceclass(), id);
+            GetInstanceClass(packet.getinstanceclass(), wrapper);
             break;
         case PacketWrapper::kGetInstanceValues:
-            GetInstanceValues(packet.getinstancevalues(), id);
+            GetInstanceValues(packet.getinstancevalues(), wrapper);
             break;
         case PacketWrapper::kCreateObject:
-            CreateObject(packet.createobject(), id);
+            CreateObject(packet.createobject(), wrapper);
             break;
         case PacketWrapper::kAddSafePtrAddress:
-            AddSafePtrAddress(packet.addsafeptraddress(), id);
+            AddSafePtrAddress(packet.addsafeptraddress(), wrapper);
             break;
         case PacketWrapper::kGetSafePtrAddresses:
-            SendSafePtrList(id);
+            FillSafePtrList(wrapper);
             break;
         case PacketWrapper::kGetTypeComplete:
-            GetTypeComplete(packet.gettypecomplete(), id);
+            GetTypeComplete(packet.gettypecomplete(), wrapper);
+            break;
+        case PacketWrapper::kBatch:
+            RunBatch(packet.batch(), wrapper);
+            break;
+        case PacketWrapper::kFrameBudget:
+            FrameBudget(packet.framebudget(), wrapper);
+            break;
+        case PacketWrapper::kGetServerStats:
+            GetServerStats(packet.getserverstats(), wrapper);
+            break;
+        case PacketWrapper::kCacheBudget:
+            CacheBudget(packet.cachebudget(), wrapper);
+            break;
+        case PacketWrapper::kSendSettings:
+            SendSettings(packet.sendsettings(), wrapper);
+            break;
+        case PacketWrapper::kWatch:
+            Watch(packet.watch(), wrapper, stream);
+            break;
+        case PacketWrapper::kUnwatch:
+            Unwatch(packet.unwatch(), wrapper, stream);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+void Manager::ProcessMessage(std::shared_ptr<PacketWrapper const> const& request, Socket::Connection const& connection, Stats::Trace trace) {
+    auto& packet = *request;
+    LOG_DEBUG("processing packet: {}", packet.DebugString());
+
+    auto replyKey = GetReplyKey(packet);
+    if (replyKey) {
+        if (auto reply = FindCachedReply(*replyKey, packet.queryresultid())) {
+            trace.finished = Stats::Clock::now();
+            if (trace.type)
+                Stats::RecordRequest(trace);
+            Socket::SendSerialized(std::move(*reply), connection, trace);
+            return;
+        }
+    }
+
+    // the result is built on the same arena as the request, so both are freed together once it has been sent
+    auto arena = packet.GetArena();
+    auto result = arena ? std::shared_ptr<PacketWrapper>(request, google::protobuf::Arena::Create<PacketWrapper>(arena))
+                        : std::make_shared<PacketWrapper>();
+    auto& wrapper = *result;
+    wrapper.set_queryresultid(packet.queryresultid());
+#ifdef ALLOCATION_STATS
+    auto allocations = mem::allocations();
+#endif
+
+    bool valid = HandlePacket(packet, wrapper, &connection);
+    trace.finished = Stats::Clock::now();
+    if (trace.type)
+        Stats::RecordRequest(trace);
+    if (!valid) {
+        LOG_ERROR("Invalid packet type {}!", (int) packet.Packet_case());
+        return;
+    }
+#ifdef ALLOCATION_STATS
+    LOG_INFO(
+        "packet type {} made {} heap allocations, arena used {} bytes",
+        (int) packet.Packet_case(),
+        mem::allocations() - allocations,
+        arena ? arena->SpaceUsed() : 0
+    );
+#endif
+    if (replyKey)
+        CacheReply(*replyKey, wrapper);
+    // streamed results have already been sent in chunks
+    if (wrapper.Packet_case() == PacketWrapper::PACKET_NOT_SET)
+        return;
+    // results only go back to the connection that asked for them
+    Socket::Send(std::move(result), connection, trace);
+}
+
+// queries waiting for the main thread, by connection and id, with whether they have been cancelled
+static std::mutex pendingMutex;
+static std::map<std::pair<void const*, std::uint64_t>, bool> pendingRequests;
+
+// requests that only read il2cpp metadata or raw memory, and so don't have to wait for the main thread
+static bool RunsOnWorker(PacketWrapper const& packet) {
+    switch (packet.Packet_case()) {
+        case PacketWrapper::kFillTypeInfo:
+        case PacketWrapper::kGetClassDetails:
+        case PacketWrapper::kGetInstanceClass:
+        case PacketWrapper::kReadMemory:
+        case PacketWrapper::kGetTypeComplete:
+        case PacketWrapper::kGetServerStats:
+        case PacketWrapper::kCacheBudget:
+        case PacketWrapper::kSendSettings:
+            return true;
+        case PacketWrapper::kBatch:
+            return std::all_of(packet.batch().requests().begin(), packet.batch().requests().end(), RunsOnWorker);
+        default:
+            return false;
+    }
+}
+
+// only for requests on the main thread, since the workers run everything in order
+static QRUE::Priority GetPriority(PacketWrapper const& packet) {
+    switch (packet.Packet_case()) {
+        case PacketWrapper::kSearchObjects:
+        case PacketWrapper::kQueryGameObjects:
+        case PacketWrapper::kGetAllGameObjects:
+            return QRUE::Priority::Bulk;
+        default:
+            return QRUE::Priority::Interactive;
+    }
+}
+
+static void CancelRequest(CancelRequest const& packet, PacketWrapper& wrapper, void const* owner) {
+    std::unique_lock lock(pendingMutex);
+    auto pending = pendingRequests.find({owner, packet.queryresultid()});
+    bool cancelled = pending != pendingRequests.end() && !pending->second;
+    if (cancelled)
+        pending->second = true;
+    lock.unlock();
+
+    LOG_DEBUG("Cancelling query {}: {}", packet.queryresultid(), cancelled);
+    wrapper.mutable_cancelrequestresult()->set_cancelled(cancelled);
+}
+
+void Manager::QueueMessage(std::shared_ptr<PacketWrapper const> request, Socket::Connection const& connection, Stats::Trace trace) {
+    auto owner = connection.lock().get();
+    if (!owner)
+        return;
+
+    // cancellation can't wait behind the requests it is cancelling
+    if (request->has_cancelrequest()) {
+        PacketWrapper wrapper;
+        wrapper.set_queryresultid(request->queryresultid());
+        CancelRequest(request->cancelrequest(), wrapper, owner);
+        Socket::Send(std::move(wrapper), connection);
+        return;
+    }
+
+    std::pair<void const*, std::uint64_t> key(owner, request->queryresultid());
+    {
+        std::unique_lock lock(pendingMutex);
+        pendingRequests[key] = false;
+    }
+
+    bool worker = RunsOnWorker(*request);
+    auto priority = GetPriority(*request);
+    trace.type = request->Packet_case();
+    trace.queued = Stats::Clock::now();
+    Task run = [request = std::move(request), connection, key, trace]() mutable {
+        std::unique_lock lock(pendingMutex);
+        auto pending = pendingRequests.find(key);
+        bool cancelled = pending != pendingRequests.end() && pending->second;
+        if (pending != pendingRequests.end())
+            pendingRequests.erase(pending);
+        lock.unlock();
+
+        if (cancelled || connection.expired()) {
+            LOG_DEBUG("Dropping query {} before it started", key.second);
+            Stats::RecordRequest(trace);
+            return;
+        }
+        trace.started = Stats::Clock::now();
+        ProcessMessage(request, connection, trace);
+    };
+
+    if (worker)
+        Workers::Schedule(std::move(run));
+    else
+        QRUE::MainThreadRunner::Schedule(std::move(run), priority);
+}
+
+enum class MemberKind { Field, Property, Method, Generic };
+// replaces a member id, returning 0 if it has no replacement
+using IdMap = std::function<std::uint64_t(MemberKind, std::uint64_t)>;
+
+static void MapIds(ProtoTypeInfo& type, IdMap const& map);
+
+static void MapIds(ProtoClassInfo& clazz, IdMap const& map) {
+    for (auto& generic : *clazz.mutable_generics())
+        MapIds(generic, map);
+}
+
+static void MapIds(ProtoFieldInfo& field, IdMap const& map) {
+    field.set_id(map(MemberKind::Field, field.id()));
+    MapIds(*field.mutable_type(), map);
+}
+
+// struct infos include the fields of the struct, so type infos have ids as well
+static void MapIds(ProtoTypeInfo& type, IdMap const& map) {
+    switch (type.Info_case()) {
+        case ProtoTypeInfo::kArrayInfo:
+            MapIds(*type.mutable_arrayinfo()->mutable_membertype(), map);
+            break;
+        case ProtoTypeInfo::kStructInfo:
+            MapIds(*type.mutable_structinfo()->mutable_clazz(), map);
+            for (auto& [offset, field] : *type.mutable_structinfo()->mutable_fieldoffsets())
+                MapIds(field, map);
+            break;
+        case ProtoTypeInfo::kClassInfo:
+            MapIds(*type.mutable_classinfo(), map);
+            break;
+        case ProtoTypeInfo::kGenericInfo:
+            type.mutable_genericinfo()->set_generichandle(map(MemberKind::Generic, type.genericinfo().generichandle()));
+            break;
+        case ProtoTypeInfo::kEnumInfo:
+            MapIds(*type.mutable_enuminfo()->mutable_clazz(), map);
             break;
         default:
-            LOG_ERROR("Invalid packet type {}!", (int) packet.Packet_case());
+            break;
+    }
+}
+
+static void MapIds(ProtoClassDetails& details, IdMap const& map) {
+    MapIds(*details.mutable_clazz(), map);
+    for (auto fields : {details.mutable_fields(), details.mutable_staticfields()}) {
+        for (auto& field : *fields)
+            MapIds(field, map);
+    }
+    for (auto properties : {details.mutable_properties(), details.mutable_staticproperties()}) {
+        for (auto& property : *properties) {
+            property.set_id(map(MemberKind::Property, property.id()));
+            if (property.has_getterid())
+                property.set_getterid(map(MemberKind::Method, property.getterid()));
+            if (property.has_setterid())
+                property.set_setterid(map(MemberKind::Method, property.setterid()));
+            MapIds(*property.mutable_type(), map);
+        }
+    }
+    for (auto methods : {details.mutable_methods(), details.mutable_staticmethods()}) {
+        for (auto& method : *methods) {
+            method.set_id(map(MemberKind::Method, method.id()));
+            for (auto& arg : *method.mutable_args())
+                MapIds(*arg.mutable_type(), map);
+            MapIds(*method.mutable_returntype(), map);
+        }
+    }
+    for (auto& interface : *details.mutable_interfaces())
+        MapIds(interface, map);
+}
+
+struct ClassMembers {
+    std::vector<FieldInfo const*> fields;
+    std::vector<PropertyInfo const*> properties;
+    std::vector<MethodInfo const*> methods;
+};
+
+// the lists that saved member indices refer to
+static ClassMembers const& GetMembers(Il2CppClass const* clazz, std::unordered_map<Il2CppClass const*, ClassMembers>& members) {
+    auto [entry, added] = members.try_emplace(clazz);
+    if (added)
+        entry->second = {GetFields(clazz), GetProperties(clazz), GetMethods(clazz)};
+    return entry->second;
+}
+
+static std::vector<Il2CppImage const*> GetImages() {
+    std::vector<Il2CppImage const*> ret;
+    std::size_t count;
+    auto assemblies = il2cpp_functions::domain_get_assemblies(il2cpp_functions::domain_get(), &count);
+    for (std::size_t i = 0; i < count; i++) {
+        if (assemblies[i]->image)
+            ret.emplace_back(assemblies[i]->image);
+    }
+    return ret;
+}
+
+// classes that are never instantiated themselves, or that il2cpp fails to set up, aren't warmed up
+static Il2CppClass* GetWarmUpClass(Il2CppImage const* image, std::size_t index) {
+    if (!image || index >= image->typeCount)
+        return nullptr;
+    auto clazz = const_cast<Il2CppClass*>(il2cpp_functions::image_get_class(image, index));
+    if (!clazz || il2cpp_functions::class_is_generic(clazz) || !il2cpp_functions::Class_Init(clazz))
+        return nullptr;
+    return clazz;
+}
+
+// saved type infos are added to their cache as well, as they would have been while finding the details
+static void CacheSavedTypeInfos(ProtoClassDetails const& details) {
+    for (auto fields : {&details.fields(), &details.staticfields()}) {
+        for (auto const& field : *fields)
+            CacheTypeInfo(asPtr(FieldInfo const, field.id())->type, field.type());
+    }
+    for (auto methods : {&details.methods(), &details.staticmethods()}) {
+        for (auto const& method : *methods)
+            CacheTypeInfo(asPtr(MethodInfo const, method.id())->return_type, method.returntype());
+    }
+}
+
+// generic parameter handles point into the global metadata, so they are saved relative to a known one
+static std::uint64_t GetGenericAnchor() {
+    static auto method = il2cpp_utils::FindMethodUnsafe("System", "Activator", "CreateInstance", 0);
+    if (!method)
+        return 0;
+    auto info = GetTypeInfo(method->return_type);
+    return info.has_genericinfo() ? info.genericinfo().generichandle() : 0;
+}
+
+// the warm-up stops once the class cache is this full, as anything more would only evict what it just added
+// shards evict on their own, so some room is left for classes that hash unevenly
+static std::size_t GetWarmUpRoom() {
+    auto stats = cachedClasses.GetStats();
+    auto limit = stats.budget / 4 * 3;
+    return stats.bytes < limit ? limit - stats.bytes : 0;
+}
+
+// reads the details saved for this build, with their ids pointing to this launch's members again
+// stops after room bytes of details, which is as much as the cache would keep
+static SavedDetails LoadMetadata(
+    std::filesystem::path const& path, std::string const& build, std::vector<Il2CppImage const*> const& images, std::size_t room
+) {
+    SavedDetails ret;
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return ret;
+    google::protobuf::io::IstreamInputStream input(&file);
+
+    bool clean;
+    ProtoMetadataHeader header;
+    if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(&header, &input, &clean) || header.build() != build) {
+        LOG_INFO("Saved metadata is not for build {}", build);
+        return ret;
+    }
+
+    std::unordered_map<std::string_view, Il2CppImage const*> imagesByName;
+    for (auto image : images)
+        imagesByName.emplace(image->name, image);
+    std::vector<Il2CppImage const*> savedImages;
+    for (auto const& name : header.images()) {
+        auto image = imagesByName.find(name);
+        savedImages.emplace_back(image == imagesByName.end() ? nullptr : image->second);
     }
+    auto getClass = [&savedImages](std::uint32_t image, std::uint32_t type) {
+        return image < savedImages.size() ? GetWarmUpClass(savedImages[image], type) : nullptr;
+    };
+
+    std::unordered_map<Il2CppClass const*, ClassMembers> members;
+    auto anchor = GetGenericAnchor();
+    std::size_t loaded = 0;
+    while (loaded < room && !warmUpStopped) {
+        // parsing merges into the message, so each entry needs a new one
+        ProtoMetadataEntry entry;
+        if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(&entry, &input, &clean))
+            break;
+        auto clazz = getClass(entry.image(), entry.type());
+        if (!clazz)
+            continue;
+
+        bool failed = false;
+        MapIds(*entry.mutable_details(), [&](MemberKind kind, std::uint64_t id) -> std::uint64_t {
+            if (kind == MemberKind::Generic) {
+                failed = failed || !anchor;
+                return id + anchor;
+            }
+            if (id >= (std::uint64_t) entry.members_size()) {
+                failed = true;
+                return 0;
+            }
+            auto const& ref = entry.members(id);
+            auto owner = getClass(ref.image(), ref.type());
+            if (!owner) {
+                failed = true;
+                return 0;
+            }
+            auto const& ownerMembers = GetMembers(owner, members);
+            std::size_t index = ref.member();
+            if (kind == MemberKind::Field && index < ownerMembers.fields.size())
+                return asInt(ownerMembers.fields[index]);
+            if (kind == MemberKind::Property && index < ownerMembers.properties.size())
+                return asInt(ownerMembers.properties[index]);
+            if (kind == MemberKind::Method && index < ownerMembers.methods.size())
+                return asInt(ownerMembers.methods[index]);
+            failed = true;
+            return 0;
+        });
+        if (failed)
+            continue;
+
+        CacheSavedTypeInfos(entry.details());
+        loaded += entry.details().SpaceUsedLong();
+        ret.emplace(clazz, std::move(*entry.mutable_details()));
+    }
+    if (loaded < room && !warmUpStopped && !clean)
+        LOG_ERROR("Saved metadata at {} was cut off", path.string());
+    return ret;
+}
+
+template <class T>
+static std::ptrdiff_t IndexOf(std::vector<T const*> const& members, std::uint64_t id) {
+    auto found = std::find(members.begin(), members.end(), asPtr(T const, id));
+    return found == members.end() ? -1 : found - members.begin();
+}
+
+using ClassLocations = std::unordered_map<Il2CppClass const*, std::pair<std::uint32_t, std::uint32_t>>;
+
+// replaces the member ids with indices into the classes' members, which fails for members of generic instances
+static bool SaveEntry(
+    ProtoMetadataEntry& entry, ClassLocations const& locations, std::unordered_map<Il2CppClass const*, ClassMembers>& members, std::uint64_t anchor
+) {
+    std::unordered_map<std::uint64_t, std::uint64_t> refs;
+    bool failed = false;
+    MapIds(*entry.mutable_details(), [&](MemberKind kind, std::uint64_t id) -> std::uint64_t {
+        if (kind == MemberKind::Generic) {
+            failed = failed || !anchor;
+            return id - anchor;
+        }
+        if (auto ref = refs.find(id); ref != refs.end())
+            return ref->second;
+
+        Il2CppClass const* owner = nullptr;
+        if (kind == MemberKind::Field)
+            owner = asPtr(FieldInfo const, id)->parent;
+        else if (kind == MemberKind::Property)
+            owner = asPtr(PropertyInfo const, id)->parent;
+        else
+            owner = asPtr(MethodInfo const, id)->klass;
+        auto location = owner ? locations.find(owner) : locations.end();
+        if (location == locations.end()) {
+            failed = true;
+            return 0;
+        }
+
+        auto const& ownerMembers = GetMembers(owner, members);
+        std::ptrdiff_t index;
+        if (kind == MemberKind::Field)
+            index = IndexOf(ownerMembers.fields, id);
+        else if (kind == MemberKind::Property)
+            index = IndexOf(ownerMembers.properties, id);
+        else
+            index = IndexOf(ownerMembers.methods, id);
+        if (index < 0) {
+            failed = true;
+            return 0;
+        }
+
+        auto& ref = *entry.add_members();
+        ref.set_image(location->second.first);
+        ref.set_type(location->second.second);
+        ref.set_member(index);
+        refs.emplace(id, entry.members_size() - 1);
+        return entry.members_size() - 1;
+    });
+    return !failed;
+}
+
+static void WarmUpClasses(std::string const& build) {
+    auto path = std::filesystem::path(GetDataPath()) / "metadata.bin";
+    auto start = Stats::Clock::now();
+    auto elapsed = [&start]() { return std::chrono::duration_cast<std::chrono::milliseconds>(Stats::Clock::now() - start).count(); };
+    auto images = GetImages();
+
+    // only the classes the cache can keep are warmed up, and the rest are found when they are first requested
+    auto countCached = [](std::vector<Il2CppClass const*> const& classes) {
+        return std::count_if(classes.begin(), classes.end(), [](auto clazz) { return cachedClasses.Contains(clazz); });
+    };
+
+    auto saved = LoadMetadata(path, build, images, GetWarmUpRoom());
+    if (!saved.empty()) {
+        std::vector<Il2CppClass const*> classes;
+        for (auto const& [clazz, _] : saved)
+            classes.emplace_back(clazz);
+        // parents are taken from the saved details as they are reached, and ones already cached are left alone
+        for (auto clazz : classes) {
+            if (warmUpStopped)
+                return;
+            GetClassDetailsCached(clazz, &saved);
+        }
+        LOG_INFO("Loaded saved metadata for {} classes, {} still cached, in {}ms", classes.size(), countCached(classes), elapsed());
+        return;
+    }
+
+    // classes are saved by their position, which stays the same for the same build
+    // they are only located here, and not set up until they are warmed up
+    ClassLocations locations;
+    ProtoMetadataHeader header;
+    header.set_build(build);
+    for (std::uint32_t i = 0; i < images.size(); i++) {
+        header.add_images(images[i]->name);
+        for (std::uint32_t j = 0; j < images[i]->typeCount; j++) {
+            if (auto clazz = il2cpp_functions::image_get_class(images[i], j))
+                locations.try_emplace(clazz, i, j);
+        }
+    }
+
+    // written next to the old file and then moved over it, so a save that is cut off is never loaded
+    auto temp = path;
+    temp += ".tmp";
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    std::vector<Il2CppClass const*> classes;
+    std::size_t savedCount = 0;
+    {
+        google::protobuf::io::OstreamOutputStream output(&file);
+        google::protobuf::util::SerializeDelimitedToZeroCopyStream(header, &output);
+
+        std::unordered_map<Il2CppClass const*, ClassMembers> members;
+        auto anchor = GetGenericAnchor();
+        ProtoMetadataEntry entry;
+        // only what was warmed up is saved, which is as much as the next launch could load
+        for (std::uint32_t i = 0; i < images.size() && GetWarmUpRoom() > 0 && !warmUpStopped; i++) {
+            for (std::uint32_t j = 0; j < images[i]->typeCount && GetWarmUpRoom() > 0 && !warmUpStopped; j++) {
+                auto clazz = GetWarmUpClass(images[i], j);
+                if (!clazz)
+                    continue;
+                classes.emplace_back(clazz);
+                auto node = GetClassDetailsCached(clazz);
+                entry.Clear();
+                entry.set_image(i);
+                entry.set_type(j);
+                *entry.mutable_details() = node->details;
+                if (SaveEntry(entry, locations, members, anchor)) {
+                    google::protobuf::util::SerializeDelimitedToZeroCopyStream(entry, &output);
+                    savedCount++;
+                }
+            }
+        }
+    }
+    file.close();
+    // the classes weren't all saved, so the next launch finds them again instead
+    if (warmUpStopped)
+        return;
+
+    std::error_code error;
+    if (!file.fail())
+        std::filesystem::rename(temp, path, error);
+    if (file.fail() || error)
+        LOG_ERROR("Failed to save metadata to {}", path.string());
+    LOG_INFO("Warmed up metadata for {} classes, {} still cached, saving {}, in {}ms", classes.size(), countCached(classes), savedCount, elapsed());
+}
+
+void Manager::WarmUp(std::string build) {
+    warmUpThread = std::thread([build = std::move(build)]() {
+        // stays out of the way of the game and the query threads
+        setpriority(PRIO_PROCESS, gettid(), 19);
+        auto thread = il2cpp_functions::thread_attach(il2cpp_functions::domain_get());
+        WarmUpClasses(build);
+        il2cpp_functions::thread_detach(thread);
+    });
 }
@@ -1,11 +1,79 @@
 #include "mem.hpp"
 
 #include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
 namespace {
     auto pageSize = sysconf(_SC_PAGESIZE);
+
+    struct region {
+        std::uintptr_t start;
+        std::uintptr_t end;
+    };
+
+    // readable mappings, sorted and with adjacent ones merged
+    std::vector<region> regions;
+    std::shared_mutex regionsMutex;
+
+    // reading the maps costs far more than a lookup, so repeated misses on unmapped addresses only reload this often
+    constexpr std::chrono::milliseconds reloadInterval{100};
+    std::atomic<std::chrono::steady_clock::rep> lastLoad{0};
+
+    // keeps the old index if the new one can't be allocated
+    void load_regions() noexcept {
+        std::vector<region> loaded;
+        auto file = fopen("/proc/self/maps", "r");
+        if (!file)
+            return;
+        try {
+            std::uintptr_t start, end;
+            char perms[5];
+            while (fscanf(file, "%" SCNxPTR "-%" SCNxPTR " %4s%*[^\n]", &start, &end, perms) == 3) {
+                if (perms[0] != 'r')
+                    continue;
+                if (!loaded.empty() && loaded.back().end == start)
+                    loaded.back().end = end;
+                else
+                    loaded.push_back({start, end});
+            }
+        } catch (std::bad_alloc const&) {
+            fclose(file);
+            return;
+        }
+        fclose(file);
+        std::unique_lock lock(regionsMutex);
+        regions = std::move(loaded);
+    }
+
+    // true for only one caller once the interval has passed since the last load
+    bool should_reload() noexcept {
+        auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        auto last = lastLoad.load(std::memory_order_relaxed);
+        if (last != 0 && now - last < std::chrono::steady_clock::duration(reloadInterval).count())
+            return false;
+        return lastLoad.compare_exchange_strong(last, now, std::memory_order_relaxed);
+    }
+
+    std::size_t find_readable(std::uintptr_t address, std::size_t size) {
+        std::shared_lock lock(regionsMutex);
+        auto found = std::upper_bound(regions.begin(), regions.end(), address, [](std::uintptr_t address, region const& region) {
+            return address < region.end;
+        });
+        if (found == regions.end() || found->start > address)
+            return 0;
+        return std::min<std::size_t>(size, found->end - address);
+    }
 }
 
 int mem::operator&(protection a, protection b) noexcept {
@@ -32,9 +100,52 @@ int mem::protect(void* data, std::size_t size, protection prot) noexcept {
         return 0;
 }
 
+std::size_t mem::readable(void const* data, std::size_t size) noexcept {
+    auto address = reinterpret_cast<std::uintptr_t>(data);
+    auto ret = find_readable(address, size);
+    if (ret < size && should_reload()) {
+        load_regions();
+        ret = find_readable(address, size);
+    }
+    return ret;
+}
+
 void* operator new(std::size_t size, mem::aligned_t, std::size_t align) noexcept {
     return ::operator new(size, static_cast<std::align_val_t>(align));
 }
 void* operator new[](std::size_t size, mem::aligned_t, std::size_t align) noexcept {
     return ::operator new[](size, static_cast<std::align_val_t>(align));
 }
+
+#ifdef ALLOCATION_STATS
+namespace {
+    thread_local std::uint64_t allocationCount = 0;
+}
+
+std::uint64_t mem::allocations() noexcept {
+    return allocationCount;
+}
+
+// hidden so that only allocations made from this library are counted
+__attribute__((visibility("hidden"))) void* operator new(std::size_t size) {
+    allocationCount++;
+    if (auto ret = malloc(size ? size : 1))
+        return ret;
+    throw std::bad_alloc();
+}
+__attribute__((visibility("hidden"))) void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+__attribute__((visibility("hidden"))) void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+__attribute__((visibility("hidden"))) void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+__attribute__((visibility("hidden"))) void operator delete(void* ptr, std::size_t) noexcept {
+    free(ptr);
+}
+__attribute__((visibility("hidden"))) void operator delete[](void* ptr, std::size_t) noexcept {
+    free(ptr);
+}
+#endif
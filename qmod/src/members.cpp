@@ -153,24 +153,29 @@ ProtoDataSegment OutputClass(ProtoClassInfo const& info, void* value, int size)
     return ret;
 }
 
-ProtoDataSegment OutputArray(ProtoArrayInfo const& info, void* value, int size) {
+ProtoDataSegment OutputArray(ProtoArrayInfo const& info, Il2CppArray* arr, std::size_t begin, std::size_t end) {
     ProtoDataSegment ret;
-    LOG_DEBUG("Outputting array {}", fmt::ptr(*(void**) value));
-    auto arr = *(Il2CppArray**) value;
     if (!arr || arr->max_length <= 0)
         return ret;
 
     auto ret_arr = ret.mutable_arraydata();
 
+    end = std::min(end, (std::size_t) arr->max_length);
     void* values = pointerOffset(arr, sizeof(Il2CppArray));
     int memberSize = info.membertype().size();
-    LOG_DEBUG("Length {} member size {}", arr->max_length, memberSize);
-    for (int i = 0; i < arr->max_length; i++)
+    LOG_DEBUG("Length {} member size {} range {}-{}", arr->max_length, memberSize, begin, end);
+    for (std::size_t i = begin; i < end; i++)
         *ret_arr->add_data() = OutputType(info.membertype(), pointerOffset(values, i * memberSize));
 
     return ret;
 }
 
+ProtoDataSegment OutputArray(ProtoArrayInfo const& info, void* value, int size) {
+    LOG_DEBUG("Outputting array {}", fmt::ptr(*(void**) value));
+    auto arr = *(Il2CppArray**) value;
+    return OutputArray(info, arr, 0, arr ? arr->max_length : 0);
+}
+
 ProtoDataSegment OutputStruct(ProtoStructInfo const& info, void* value, int size) {
     ProtoDataSegment ret;
     LOG_DEBUG("Outputting struct");
@@ -289,6 +294,10 @@ bool shouldGetParamName(MethodInfo const* method) {
 }
 #endif
 
+static bool IsSkipped(MethodInfo const* method) {
+    return method->name == std::string_view("get_renderingDisplaySize");
+}
+
 namespace MethodUtils {
     MethodResult Run(MethodInfo const* method, ProtoDataPayload const& object, std::vector<ProtoDataPayload> const& args) {
         void* inst = nullptr;
@@ -303,7 +312,7 @@ namespace MethodUtils {
         LOG_DEBUG("Running method {} {}", fmt::ptr(method), method->name);
         LOG_DEBUG("{} parameters", method->parameters_count);
 
-        if (method->name == std::string("get_renderingDisplaySize")) {
+        if (IsSkipped(method)) {
             LOG_INFO("Skipping get_renderingDisplaySize due to crash");
             return {HandleReturn(method), {}, ""};
         }
@@ -380,7 +389,7 @@ namespace FieldUtils {
 
         return Get(field, inst, object.typeinfo().has_classinfo() || object.typeinfo().has_arrayinfo());
     }
-    ProtoDataPayload Get(FieldInfo const* field, void* object, bool isObject) {
+    static void GetValue(FieldInfo const* field, void* object, bool isObject, void* ret) {
         LOG_DEBUG("Getting field {}", field->name);
         LOG_DEBUG("Field type: {} = {}", (int) field->type->type, il2cpp_functions::type_get_name(field->type));
 
@@ -388,19 +397,35 @@ namespace FieldUtils {
         if (!isObject)
             object = pointerOffset(object, -(int) sizeof(Il2CppObject));
 
-        size_t size = fieldTypeSize(field->type);
-        char ret[size];
         // in the case of either a value type or not, the value we want will be copied to what we return
         if (ClassUtils::GetIsStatic(field))
-            il2cpp_functions::field_static_get_value(const_cast<FieldInfo*>(field), (void*) ret);
+            il2cpp_functions::field_static_get_value(const_cast<FieldInfo*>(field), ret);
         else
-            il2cpp_functions::field_get_value((Il2CppObject*) object, const_cast<FieldInfo*>(field), (void*) ret);
+            il2cpp_functions::field_get_value((Il2CppObject*) object, const_cast<FieldInfo*>(field), ret);
+    }
+
+    ProtoDataPayload Get(FieldInfo const* field, void* object, bool isObject) {
+        size_t size = fieldTypeSize(field->type);
+        char ret[size];
+        GetValue(field, object, isObject, (void*) ret);
 
         // handles the transformation of the data if necessary
         auto typeInfo = ClassUtils::GetTypeInfo(field->type);
         return OutputData(typeInfo, ret);
     }
 
+    Il2CppArray* GetArray(FieldInfo const* field, ProtoDataPayload const& object) {
+        if (field->type->type != IL2CPP_TYPE_SZARRAY)
+            return nullptr;
+        void* inst = nullptr;
+        if (!ClassUtils::GetIsStatic(field))
+            inst = HandleType(object.typeinfo(), object.data());
+
+        Il2CppArray* ret = nullptr;
+        GetValue(field, inst, object.typeinfo().has_classinfo() || object.typeinfo().has_arrayinfo(), &ret);
+        return ret;
+    }
+
     void Set(FieldInfo const* field, ProtoDataPayload const& object, ProtoDataPayload const& arg) {
         void* inst = nullptr;
         if (!ClassUtils::GetIsStatic(field))
@@ -434,3 +459,78 @@ namespace FieldUtils {
         return info;
     }
 }
+
+void AccessorPlan::AddField(std::uint64_t id, FieldInfo const* field) {
+    fields.push_back({id, field, ClassUtils::GetIsStatic(field), field->offset, ClassUtils::GetTypeInfo(field->type)});
+}
+
+void AccessorPlan::AddGetter(std::uint64_t id, MethodInfo const* getter) {
+    if (IsSkipped(getter)) {
+        LOG_INFO("Skipping {} due to crash", getter->name);
+        return;
+    }
+    getters.push_back({id, getter, ClassUtils::GetIsStatic(getter), ClassUtils::GetTypeInfo(getter->return_type)});
+}
+
+AccessorPlan AccessorPlan::Select(std::set<std::uint64_t> const& ids) const {
+    AccessorPlan ret;
+    std::copy_if(fields.begin(), fields.end(), std::back_inserter(ret.fields), [&ids](Field const& field) { return ids.contains(field.id); });
+    std::copy_if(getters.begin(), getters.end(), std::back_inserter(ret.getters), [&ids](Getter const& getter) { return ids.contains(getter.id); });
+    return ret;
+}
+
+std::size_t AccessorPlan::SpaceUsed() const {
+    std::size_t ret = sizeof(AccessorPlan) + fields.capacity() * sizeof(Field) + getters.capacity() * sizeof(Getter);
+    for (auto const& field : fields)
+        ret += field.type.SpaceUsedLong() - sizeof(ProtoTypeInfo);
+    for (auto const& getter : getters)
+        ret += getter.type.SpaceUsedLong() - sizeof(ProtoTypeInfo);
+    return ret;
+}
+
+void AccessorPlan::Read(ProtoDataPayload const& instance, GetInstanceValuesResult& ret) const {
+    void* object = HandleType(instance.typeinfo(), instance.data());
+    bool isObject = instance.typeinfo().has_classinfo() || instance.typeinfo().has_arrayinfo();
+    // field offsets include the object header, which value types don't have
+    void* base = object && !isObject ? pointerOffset(object, -(int) sizeof(Il2CppObject)) : object;
+
+    ret.mutable_values()->Reserve(ret.values_size() + fields.size() + getters.size());
+
+    for (auto const& field : fields) {
+        if (field.isStatic) {
+            char value[field.type.size()];
+            il2cpp_functions::field_static_get_value(const_cast<FieldInfo*>(field.field), value);
+            auto& pair = *ret.add_values();
+            pair.set_id(field.id);
+            *pair.mutable_data() = OutputType(field.type, value);
+        } else if (base) {
+            // the same copy field_get_value would make, but read in place
+            auto& pair = *ret.add_values();
+            pair.set_id(field.id);
+            *pair.mutable_data() = OutputType(field.type, pointerOffset(base, field.offset));
+        }
+    }
+
+    for (auto const& getter : getters) {
+        if (!getter.isStatic && !object)
+            continue;
+        Il2CppException* ex = nullptr;
+        auto value = il2cpp_functions::runtime_invoke(getter.method, getter.isStatic ? nullptr : object, nullptr, &ex);
+        if (ex) {
+            LOG_ERROR("getting property failed with error: {}", il2cpp_utils::ExceptionToString(ex));
+            continue;
+        }
+
+        bool boxed = getter.method->return_type->valuetype;
+        if (boxed && !value)
+            continue;
+
+        auto& pair = *ret.add_values();
+        pair.set_id(getter.id);
+        if (boxed) {
+            *pair.mutable_data() = OutputType(getter.type, il2cpp_functions::object_unbox(value));
+            il2cpp_functions::GC_free(value);
+        } else
+            *pair.mutable_data() = OutputType(getter.type, &value);
+    }
+}
@@ -1,49 +1,290 @@
 #include "socket.hpp"
 
 #include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
 #include <websocketpp/server.hpp>
 
-#include "MainThreadRunner.hpp"
 #include "main.hpp"
 #include "manager.hpp"
+#include "stats.hpp"
 
 using namespace websocketpp;
 
+// notifications waiting beyond this are dropped, and replies stop the connection being read from until it drains
+static constexpr std::size_t maxQueuedPackets = 256;
+// reading resumes once a paused connection's queue is down to this
+static constexpr std::size_t resumeQueuedPackets = maxQueuedPackets / 2;
+// stop handing packets to websocketpp while this much is still unwritten for a connection
+static constexpr std::size_t highWaterBytes = 4 * 1024 * 1024;
+// how long to wait for a connection above the high water mark to drain
+static constexpr long drainRetryMs = 10;
+// most packets gathered into one write on a stream connection
+static constexpr std::size_t maxStreamBatch = 64;
+// stream connections announcing a larger packet than this are closed
+static constexpr std::uint64_t maxStreamPacket = 256 * 1024 * 1024;
+// abstract unix socket name, for adb forward tcp:<port> localabstract:questeditor
+static constexpr char streamSocketName[] = "\0questeditor";
+
+namespace {
+    // negotiates permessage-deflate, though it is only used for messages above the compression threshold
+    struct DeflateConfig : config::asio {
+        typedef DeflateConfig type;
+        typedef config::asio base;
+
+        struct permessage_deflate_config {};
+        typedef extensions::permessage_deflate::enabled<permessage_deflate_config> permessage_deflate_type;
+    };
+
+    struct Outgoing {
+        std::shared_ptr<PacketWrapper const> packet;
+        // replaced by a newer one of the same type if not sent yet, for notifications that describe the whole state
+        bool replaceable;
+        Stats::Trace trace;
+        // used instead of packet for replies that are already serialized
+        std::string serialized;
+        Task onSent;
+    };
+
+    using Strand = lib::asio::strand<lib::asio::io_context::executor_type>;
+    using StreamSocket = lib::asio::generic::stream_protocol::socket;
+
+    struct Peer {
+        Peer(connection_hdl connection, lib::asio::io_context& context) :
+            connection(connection),
+            inbound(lib::asio::make_strand(context)),
+            outbound(lib::asio::make_strand(context)) {}
+
+        // the websocketpp handle, or the peer itself for stream connections
+        connection_hdl connection;
+        // parsing and sending each keep their order, but can run on different io threads at once
+        Strand inbound;
+        // also used for all operations on the stream socket
+        Strand outbound;
+        // only for connections using varint length prefixed packets instead of websockets
+        std::optional<StreamSocket> stream;
+        std::vector<char> readBuffer;
+        std::size_t readSize = 0;
+        std::mutex mutex;
+        std::deque<Outgoing> queue;
+        // whether a flush is scheduled or running on the outbound strand
+        bool flushing = false;
+        // whether new requests are left unread because too many replies are waiting
+        bool readPaused = false;
+        // whether a paused stream connection skipped its next read, which has to be started again on resuming
+        bool readStopped = false;
+        Socket::PeerStats stats;
+    };
+}
+
 static bool initialized = false;
-static server<config::asio> socketServer;
+static server<DeflateConfig> socketServer;
+static std::atomic<std::size_t> compressionThreshold = 16 * 1024;
 static std::shared_mutex connectionsMutex;
-static std::set<connection_hdl, std::owner_less<connection_hdl>> connections;
-static bool threadRunning = false;
+static std::map<connection_hdl, std::shared_ptr<Peer>, std::owner_less<connection_hdl>> connections;
+static std::vector<std::thread> ioThreads;
+static std::optional<lib::asio::ip::tcp::acceptor> tcpAcceptor;
+static std::optional<lib::asio::local::stream_protocol::acceptor> localAcceptor;
 
 static void OpenHandler(connection_hdl connection) {
-    LOG_INFO("connected: {}", connection.lock().get());
+    auto extensions = socketServer.get_con_from_hdl(connection)->get_response_header("Sec-WebSocket-Extensions");
+    LOG_INFO("connected: {} extensions: [{}]", connection.lock().get(), extensions);
+    auto peer = std::make_shared<Peer>(connection, socketServer.get_io_service());
+    std::unique_lock lock(connectionsMutex);
+    connections.emplace(connection, std::move(peer));
+}
+
+static void RemovePeer(connection_hdl const& connection) {
     std::unique_lock lock(connectionsMutex);
-    connections.emplace(connection);
+    auto found = connections.find(connection);
+    if (found == connections.end())
+        return;
+    auto& peer = *found->second;
+    std::unique_lock peerLock(peer.mutex);
+    auto& stats = peer.stats;
+    LOG_INFO(
+        "sent {} packets ({} bytes), dropped {}, coalesced {}, stalled {} times, paused reading {} times",
+        stats.sent,
+        stats.bytes,
+        stats.dropped,
+        stats.coalesced,
+        stats.stalls,
+        stats.readPauses
+    );
+    peerLock.unlock();
+    connections.erase(found);
 }
 
 static void CloseHandler(connection_hdl connection) {
     LOG_INFO("disconnected: {}", connection.lock().get());
-    std::unique_lock lock(connectionsMutex);
-    connections.erase(connection);
+    RemovePeer(connection);
 }
 
-static void MessageHandler(connection_hdl connection, server<config::asio>::message_ptr message) {
-    PacketWrapper packet;
-    packet.ParseFromArray(message->get_payload().data(), message->get_payload().size());
-    QRUE::MainThreadRunner::Schedule([packet = std::move(packet)]() { Manager::ProcessMessage(packet); });
+static std::shared_ptr<Peer> FindPeer(connection_hdl const& connection) {
+    std::shared_lock lock(connectionsMutex);
+    auto found = connections.find(connection);
+    if (found == connections.end())
+        return nullptr;
+    return found->second;
 }
 
-bool Socket::Start(int port) {
+// parsing is moved off the thread reading from the connection to keep reads and writes going
+static void Receive(std::shared_ptr<Peer> const& peer, std::string payload) {
+    Stats::Trace trace;
+    trace.received = Stats::Clock::now();
+    trace.bytes = payload.size();
+
+    lib::asio::post(peer->inbound, [connection = peer->connection, payload = std::move(payload), trace]() mutable {
+        // the request and its reply live on one arena, which is freed in one go after the reply is serialized
+        auto arena = std::make_shared<google::protobuf::Arena>();
+        auto parsed = google::protobuf::Arena::Create<PacketWrapper>(arena.get());
+        parsed->ParseFromArray(payload.data(), payload.size());
+        trace.parsed = Stats::Clock::now();
+        std::shared_ptr<PacketWrapper const> packet(std::move(arena), parsed);
+        Manager::QueueMessage(std::move(packet), connection, trace);
+    });
+}
+
+// runs on the connection's websocketpp strand
+static void MessageHandler(connection_hdl connection, server<DeflateConfig>::message_ptr message) {
+    if (auto peer = FindPeer(connection))
+        Receive(peer, std::move(message->get_raw_payload()));
+}
+
+// reading, writing and closing stream connections all happen on the peer's outbound strand
+
+static void CloseStream(std::shared_ptr<Peer> const& peer, lib::asio::error_code const& reason) {
+    if (!peer->stream->is_open())
+        return;
+    LOG_INFO("stream disconnected: {} ({})", fmt::ptr(peer.get()), reason.message());
+    lib::asio::error_code ec;
+    peer->stream->close(ec);
+    RemovePeer(peer->connection);
+}
+
+// splits complete packets off the front of the read buffer
+static bool ParseStreamPackets(std::shared_ptr<Peer> const& peer) {
+    auto data = peer->readBuffer.data();
+    std::size_t used = 0;
+
+    while (true) {
+        std::uint64_t size = 0;
+        std::size_t header = 0;
+        bool complete = false;
+        while (used + header < peer->readSize && header < 10) {
+            auto byte = (std::uint8_t) data[used + header];
+            size |= (std::uint64_t) (byte & 0x7f) << (7 * header);
+            header++;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            if (header >= 10)
+                return false;
+            break;
+        }
+        if (size > maxStreamPacket)
+            return false;
+        if (used + header + size > peer->readSize)
+            break;
+
+        Receive(peer, std::string(data + used + header, size));
+        used += header + size;
+    }
+
+    std::memmove(data, data + used, peer->readSize - used);
+    peer->readSize -= used;
+    return true;
+}
+
+static void ReadStream(std::shared_ptr<Peer> const& peer) {
+    auto& buffer = peer->readBuffer;
+    if (buffer.size() - peer->readSize < 16 * 1024)
+        buffer.resize(std::max(buffer.size() * 2, peer->readSize + 64 * 1024));
+
+    auto space = lib::asio::buffer(buffer.data() + peer->readSize, buffer.size() - peer->readSize);
+    peer->stream->async_read_some(space, lib::asio::bind_executor(peer->outbound, [peer](lib::asio::error_code ec, std::size_t read) {
+        if (ec) {
+            CloseStream(peer, ec);
+            return;
+        }
+        peer->readSize += read;
+        if (!ParseStreamPackets(peer)) {
+            LOG_ERROR("invalid packet length from stream {}", fmt::ptr(peer.get()));
+            CloseStream(peer, lib::asio::error::invalid_argument);
+            return;
+        }
+        {
+            std::unique_lock lock(peer->mutex);
+            if (peer->readPaused) {
+                peer->readStopped = true;
+                return;
+            }
+        }
+        ReadStream(peer);
+    }));
+}
+
+static void OpenStream(StreamSocket socket) {
+    auto peer = std::make_shared<Peer>(connection_hdl(), socketServer.get_io_service());
+    peer->connection = peer;
+    lib::asio::error_code ec;
+    socket.set_option(lib::asio::ip::tcp::no_delay(true), ec);
+    peer->stream.emplace(std::move(socket));
+    LOG_INFO("stream connected: {}", fmt::ptr(peer.get()));
+    {
+        std::unique_lock lock(connectionsMutex);
+        connections.emplace(peer->connection, peer);
+    }
+    lib::asio::post(peer->outbound, [peer]() { ReadStream(peer); });
+}
+
+template <class Acceptor>
+static void AcceptStream(Acceptor& acceptor) {
+    acceptor.async_accept([&acceptor](lib::asio::error_code ec, typename Acceptor::protocol_type::socket socket) {
+        if (ec == lib::asio::error::operation_aborted)
+            return;
+        if (ec)
+            LOG_ERROR("stream accept failed: {}", ec.message());
+        else
+            OpenStream(StreamSocket(std::move(socket)));
+        AcceptStream(acceptor);
+    });
+}
+
+static void ListenStream(int port) {
+    auto& context = socketServer.get_io_service();
+    try {
+        tcpAcceptor.emplace(context, lib::asio::ip::tcp::endpoint(lib::asio::ip::tcp::v4(), port));
+        AcceptStream(*tcpAcceptor);
+        LOG_INFO("listening for streams on port {}", port);
+    } catch (std::exception const& exc) {
+        tcpAcceptor.reset();
+        LOG_ERROR("stream listen failed: {}", exc.what());
+    }
+    try {
+        localAcceptor.emplace(context, lib::asio::local::stream_protocol::endpoint(std::string(streamSocketName, sizeof(streamSocketName) - 1)));
+        AcceptStream(*localAcceptor);
+        LOG_INFO("listening for streams on abstract socket {}", streamSocketName + 1);
+    } catch (std::exception const& exc) {
+        localAcceptor.reset();
+        LOG_ERROR("abstract socket listen failed: {}", exc.what());
+    }
+}
+
+bool Socket::Start(int port, int streamPort, int threads) {
     try {
         socketServer.listen(lib::asio::ip::tcp::v4(), port);
 
         socketServer.start_accept();
 
-        std::thread([]() {
-            threadRunning = true;
-            socketServer.run();
-            threadRunning = false;
-        }).detach();
+        if (streamPort > 0)
+            ListenStream(streamPort);
+
+        for (int i = 0; i < std::max(threads, 1); i++)
+            ioThreads.emplace_back([]() { socketServer.run(); });
+        LOG_INFO("running {} io threads", ioThreads.size());
 
         lib::asio::error_code ec;
         auto endpoint = socketServer.get_local_endpoint(ec);
@@ -79,18 +320,42 @@ bool Socket::Start(int port) {
 }
 
 void Socket::Stop() {
+    if (ioThreads.empty())
+        return;
     try {
-        if (threadRunning) {
-            socketServer.stop_listening();
+        socketServer.stop_listening();
 
-            std::unique_lock lock(connectionsMutex);
-            for (auto& connection : connections)
+        lib::asio::error_code ec;
+        if (tcpAcceptor)
+            tcpAcceptor->close(ec);
+        if (localAcceptor)
+            localAcceptor->close(ec);
+
+        std::unique_lock lock(connectionsMutex);
+        for (auto& [connection, peer] : connections) {
+            if (peer->stream)
+                lib::asio::post(peer->outbound, [peer]() { CloseStream(peer, lib::asio::error::shut_down); });
+            else
                 socketServer.close(connection, close::status::going_away, "configuration change");
-            connections.clear();
         }
+        connections.clear();
     } catch (std::exception const& exc) {
         LOG_ERROR("socket closing failed: {}", exc.what());
     }
+
+    // the io threads return by themselves once the close handshakes finish and nothing else is queued
+    for (auto& thread : ioThreads) {
+        if (thread.get_id() == std::this_thread::get_id())
+            thread.detach();
+        else
+            thread.join();
+    }
+    ioThreads.clear();
+    tcpAcceptor.reset();
+    localAcceptor.reset();
+    // allows the server to be started again
+    socketServer.reset();
+    LOG_INFO("socket stopped");
 }
 
 void Socket::Init() {
@@ -113,16 +378,304 @@ void Socket::Init() {
     }
 }
 
-void Socket::Send(PacketWrapper const& packet) {
+// replies are never dropped, so a connection sending requests faster than it reads the replies is made to wait instead
+// both are called with the peer's lock held
+static void PauseReading(std::shared_ptr<Peer> const& peer) {
+    LOG_INFO("send queue full, pausing reads from {}", fmt::ptr(peer.get()));
+    if (peer->stream)
+        return;
+    lib::error_code ec;
+    if (auto connection = socketServer.get_con_from_hdl(peer->connection, ec); !ec)
+        connection->pause_reading();
+}
+
+// once enough packets have been taken from the queue
+static void ResumeReading(std::shared_ptr<Peer> const& peer) {
+    if (!peer->readPaused || peer->queue.size() > resumeQueuedPackets)
+        return;
+    peer->readPaused = false;
+    if (peer->stream) {
+        if (peer->readStopped) {
+            peer->readStopped = false;
+            lib::asio::post(peer->outbound, [peer]() { ReadStream(peer); });
+        }
+        return;
+    }
+    lib::error_code ec;
+    if (auto connection = socketServer.get_con_from_hdl(peer->connection, ec); !ec)
+        connection->resume_reading();
+}
+
+static void Serialize(Outgoing& outgoing, std::string& out) {
+    if (outgoing.packet)
+        outgoing.packet->SerializeToString(&out);
+    else
+        out = std::move(outgoing.serialized);
+}
+
+static int PacketType(Outgoing const& outgoing) {
+    return outgoing.packet ? outgoing.packet->Packet_case() : 0;
+}
+
+static void FlushStream(std::shared_ptr<Peer> const& peer) {
+    std::vector<Outgoing> batch;
+    {
+        std::unique_lock lock(peer->mutex);
+        if (peer->queue.empty() || !peer->stream->is_open()) {
+            peer->queue.clear();
+            peer->flushing = false;
+            return;
+        }
+        while (!peer->queue.empty() && batch.size() < maxStreamBatch) {
+            batch.emplace_back(std::move(peer->queue.front()));
+            peer->queue.pop_front();
+        }
+        ResumeReading(peer);
+    }
+
+    struct Frame {
+        std::array<std::uint8_t, 10> header;
+        std::string body;
+        Stats::Trace trace;
+        int type;
+        Stats::Clock::time_point serializing, serialized;
+        Task onSent;
+    };
+    auto frames = std::make_shared<std::vector<Frame>>(batch.size());
+
+    // everything taken from the queue goes out in one vectored write, with each length prefix and packet as separate buffers
+    std::vector<lib::asio::const_buffer> buffers;
+    buffers.reserve(batch.size() * 2);
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        auto& frame = (*frames)[i];
+        frame.trace = batch[i].trace;
+        frame.type = PacketType(batch[i]);
+        frame.onSent = std::move(batch[i].onSent);
+        frame.serializing = Stats::Clock::now();
+        Serialize(batch[i], frame.body);
+        frame.serialized = Stats::Clock::now();
+
+        std::size_t header = 0;
+        std::uint64_t size = frame.body.size();
+        do {
+            frame.header[header++] = (size & 0x7f) | (size > 0x7f ? 0x80 : 0);
+            size >>= 7;
+        } while (size);
+
+        buffers.emplace_back(frame.header.data(), header);
+        buffers.emplace_back(frame.body.data(), frame.body.size());
+        bytes += frame.body.size();
+    }
+
+    auto onWritten = [peer, frames, bytes](lib::asio::error_code ec, std::size_t) {
+        if (ec)
+            CloseStream(peer, ec);
+        else {
+            auto sent = Stats::Clock::now();
+            for (auto const& frame : *frames)
+                Stats::RecordReply(frame.trace, frame.type, frame.serializing, frame.serialized, sent, frame.body.size());
+            {
+                std::unique_lock lock(peer->mutex);
+                peer->stats.sent += frames->size();
+                peer->stats.bytes += bytes;
+            }
+            for (auto& frame : *frames) {
+                if (frame.onSent)
+                    frame.onSent();
+            }
+        }
+        FlushStream(peer);
+    };
+    lib::asio::async_write(*peer->stream, buffers, lib::asio::bind_executor(peer->outbound, std::move(onWritten)));
+}
+
+// runs on an io thread, so serialization and writes never hold up the game
+static void Flush(std::shared_ptr<Peer> const& peer) {
+    if (peer->stream) {
+        FlushStream(peer);
+        return;
+    }
+
+    while (true) {
+        lib::error_code ec;
+        auto connection = socketServer.get_con_from_hdl(peer->connection, ec);
+        if (ec) {
+            std::unique_lock lock(peer->mutex);
+            peer->queue.clear();
+            peer->flushing = false;
+            return;
+        }
+        // a slow connection backs up in its own queue until websocketpp has written enough
+        if (connection->get_buffered_amount() > highWaterBytes) {
+            {
+                std::unique_lock lock(peer->mutex);
+                peer->stats.stalls++;
+            }
+            socketServer.set_timer(drainRetryMs, [peer](lib::error_code const&) { lib::asio::post(peer->outbound, [peer]() { Flush(peer); }); });
+            return;
+        }
+
+        Outgoing next;
+        {
+            std::unique_lock lock(peer->mutex);
+            if (peer->queue.empty()) {
+                peer->flushing = false;
+                return;
+            }
+            next = std::move(peer->queue.front());
+            peer->queue.pop_front();
+            ResumeReading(peer);
+        }
+
+        auto message = connection->get_message(frame::opcode::value::BINARY, 0);
+        auto& payload = message->get_raw_payload();
+        auto serializing = Stats::Clock::now();
+        Serialize(next, payload);
+        auto serialized = Stats::Clock::now();
+        auto size = payload.size();
+        // compression happens inside send, on this thread, if the connection negotiated it
+        bool compress = size >= compressionThreshold;
+        message->set_compressed(compress);
+        ec = connection->send(message);
+        if (ec)
+            LOG_ERROR("send failed: {}", ec.message());
+        else
+            Stats::RecordReply(next.trace, PacketType(next), serializing, serialized, Stats::Clock::now(), size);
+
+        {
+            std::unique_lock lock(peer->mutex);
+            peer->stats.sent++;
+            peer->stats.bytes += size;
+            if (compress)
+                peer->stats.compressed++;
+        }
+        if (next.onSent)
+            next.onSent();
+    }
+}
+
+// returns false if the packet was dropped
+static bool Enqueue(std::shared_ptr<Peer> const& peer, Outgoing outgoing) {
+    std::unique_lock lock(peer->mutex);
+    auto& queue = peer->queue;
+
+    if (outgoing.replaceable) {
+        auto packetCase = outgoing.packet->Packet_case();
+        auto same = std::find_if(queue.begin(), queue.end(), [packetCase](Outgoing const& queued) {
+            return queued.replaceable && queued.packet->Packet_case() == packetCase;
+        });
+        if (same != queue.end()) {
+            *same = std::move(outgoing);
+            peer->stats.coalesced++;
+            return true;
+        }
+    }
+    bool pause = false;
+    if (queue.size() >= maxQueuedPackets) {
+        // a dropped notification is made up for by the next one, but a dropped reply would never arrive
+        if (outgoing.replaceable) {
+            peer->stats.dropped++;
+            LOG_ERROR("send queue full, dropping packet of type {}", PacketType(outgoing));
+            return false;
+        }
+        pause = !peer->readPaused;
+        if (pause) {
+            peer->readPaused = true;
+            peer->stats.readPauses++;
+        }
+    }
+    queue.emplace_back(std::move(outgoing));
+    peer->stats.peakQueued = std::max(peer->stats.peakQueued, queue.size());
+
+    // paused under the lock, so it can't be resumed before it is paused
+    if (pause)
+        PauseReading(peer);
+    bool flush = !peer->flushing;
+    peer->flushing = true;
+    lock.unlock();
+    if (flush)
+        lib::asio::post(peer->outbound, [peer]() { Flush(peer); });
+    return true;
+}
+
+bool Socket::Send(PacketWrapper packet, Connection const& connection) {
+    if (!packet.IsInitialized())
+        return false;
+    return Send(std::make_shared<PacketWrapper const>(std::move(packet)), connection);
+}
+
+void Socket::Send(PacketWrapper packet, Connection const& connection, Task onSent) {
     if (!packet.IsInitialized())
         return;
-    auto string = packet.SerializeAsString();
     std::shared_lock lock(connectionsMutex);
-    for (auto const& hdl : connections) {
-        try {
-            socketServer.send(hdl, string, frame::opcode::value::BINARY);
-        } catch (std::exception const& e) {
-            LOG_ERROR("send failed: {}", e.what());
-        }
+    auto found = connections.find(connection);
+    if (found == connections.end()) {
+        LOG_DEBUG("not sending to closed connection");
+        return;
+    }
+    Enqueue(found->second, {std::make_shared<PacketWrapper const>(std::move(packet)), false, {}, {}, std::move(onSent)});
+}
+
+bool Socket::Send(std::shared_ptr<PacketWrapper const> packet, Connection const& connection, Stats::Trace const& trace) {
+    if (!packet->IsInitialized())
+        return false;
+    std::shared_lock lock(connectionsMutex);
+    auto found = connections.find(connection);
+    if (found == connections.end()) {
+        LOG_DEBUG("not sending to closed connection");
+        return false;
+    }
+    return Enqueue(found->second, {std::move(packet), false, trace});
+}
+
+void Socket::SendSerialized(std::string packet, Connection const& connection, Stats::Trace const& trace) {
+    std::shared_lock lock(connectionsMutex);
+    auto found = connections.find(connection);
+    if (found == connections.end()) {
+        LOG_DEBUG("not sending to closed connection");
+        return;
+    }
+    Enqueue(found->second, {nullptr, false, trace, std::move(packet)});
+}
+
+void Socket::Send(PacketWrapper const& packet, bool replaceable) {
+    if (!packet.IsInitialized())
+        return;
+    auto shared = std::make_shared<PacketWrapper const>(packet);
+    std::shared_lock lock(connectionsMutex);
+    for (auto const& [_, peer] : connections)
+        Enqueue(peer, {shared, replaceable});
+}
+
+bool Socket::IsBackedUp(Connection const& connection) {
+    auto peer = FindPeer(connection);
+    if (!peer)
+        return false;
+    std::unique_lock lock(peer->mutex);
+    return peer->readPaused || peer->queue.size() >= resumeQueuedPackets;
+}
+
+void Socket::SetCompressionThreshold(std::size_t bytes) {
+    compressionThreshold = bytes;
+}
+
+std::size_t Socket::GetCompressionThreshold() {
+    return compressionThreshold;
+}
+
+std::vector<Socket::PeerStats> Socket::GetStats() {
+    std::vector<PeerStats> ret;
+    std::shared_lock lock(connectionsMutex);
+    for (auto const& [connection, peer] : connections) {
+        std::unique_lock peerLock(peer->mutex);
+        auto& stats = ret.emplace_back(peer->stats);
+        stats.queued = peer->queue.size();
+        if (peer->stream)
+            continue;
+        lib::error_code ec;
+        if (auto con = socketServer.get_con_from_hdl(connection, ec); !ec)
+            stats.buffered = con->get_buffered_amount();
     }
+    return ret;
 }
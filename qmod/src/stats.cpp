@@ -0,0 +1,124 @@
+#include "stats.hpp"
+
+#include <bit>
+#include <map>
+#include <mutex>
+
+struct PacketStats {
+    Stats::Histogram parse;
+    Stats::Histogram wait;
+    Stats::Histogram handle;
+    Stats::Histogram serialize;
+    Stats::Histogram send;
+    Stats::Histogram total;
+    std::uint64_t requests = 0;
+    std::uint64_t replies = 0;
+    std::uint64_t bytesIn = 0;
+    std::uint64_t bytesOut = 0;
+};
+
+// recorded from the io threads, the main thread and the workers
+static std::mutex statsMutex;
+static std::map<int, PacketStats> packetStats;
+
+std::size_t Stats::Histogram::Bucket(std::uint64_t value) {
+    value = std::min<std::uint64_t>(value, (1ull << maxBits) - 1);
+    if (value < (1 << subBits))
+        return value;
+    int exponent = std::bit_width(value) - 1;
+    auto sub = (value >> (exponent - subBits)) & ((1 << subBits) - 1);
+    return ((exponent - subBits + 1) << subBits) + sub;
+}
+
+std::uint64_t Stats::Histogram::BucketMax(std::size_t bucket) {
+    if (bucket < (1 << subBits))
+        return bucket;
+    int exponent = (bucket >> subBits) + subBits - 1;
+    auto sub = bucket & ((1 << subBits) - 1);
+    auto width = 1ull << (exponent - subBits);
+    return (((1ull << subBits) + sub) << (exponent - subBits)) + width - 1;
+}
+
+void Stats::Histogram::Record(std::uint64_t value) {
+    counts[Bucket(value)]++;
+    count++;
+    sum += value;
+    max = std::max(max, value);
+}
+
+std::uint64_t Stats::Histogram::Percentile(double percentile) const {
+    if (count == 0)
+        return 0;
+    auto target = std::max<std::uint64_t>(1, percentile / 100 * count);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= target)
+            return std::min(BucketMax(i), max);
+    }
+    return max;
+}
+
+void Stats::Histogram::Fill(ProtoLatency& latency) const {
+    latency.set_count(count);
+    latency.set_mean(count ? sum / count : 0);
+    latency.set_p50(Percentile(50));
+    latency.set_p90(Percentile(90));
+    latency.set_p99(Percentile(99));
+    latency.set_max(max);
+}
+
+static std::uint64_t Micros(Stats::Clock::time_point start, Stats::Clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+void Stats::RecordRequest(Trace const& trace) {
+    std::unique_lock lock(statsMutex);
+    auto& stats = packetStats[trace.type];
+    stats.requests++;
+    stats.bytesIn += trace.bytes;
+    stats.parse.Record(Micros(trace.received, trace.parsed));
+    // requests dropped before starting only count towards the wait
+    if (trace.started == Clock::time_point())
+        stats.wait.Record(Micros(trace.queued, Clock::now()));
+    else {
+        stats.wait.Record(Micros(trace.queued, trace.started));
+        stats.handle.Record(Micros(trace.started, trace.finished));
+    }
+}
+
+void Stats::RecordReply(
+    Trace const& trace, int type, Clock::time_point serializing, Clock::time_point serialized, Clock::time_point sent, std::size_t bytes
+) {
+    std::unique_lock lock(statsMutex);
+    auto& stats = packetStats[trace.type ? trace.type : type];
+    stats.replies++;
+    stats.bytesOut += bytes;
+    stats.serialize.Record(Micros(serializing, serialized));
+    stats.send.Record(Micros(serialized, sent));
+    if (trace.type)
+        stats.total.Record(Micros(trace.received, sent));
+}
+
+void Stats::Fill(GetServerStatsResult& result) {
+    std::unique_lock lock(statsMutex);
+    for (auto const& [type, stats] : packetStats) {
+        auto& packet = *result.add_packets();
+        packet.set_type(type);
+        packet.set_requests(stats.requests);
+        packet.set_replies(stats.replies);
+        packet.set_bytesin(stats.bytesIn);
+        packet.set_bytesout(stats.bytesOut);
+        stats.parse.Fill(*packet.mutable_parse());
+        stats.wait.Fill(*packet.mutable_wait());
+        stats.handle.Fill(*packet.mutable_handle());
+        stats.serialize.Fill(*packet.mutable_serialize());
+        stats.send.Fill(*packet.mutable_send());
+        stats.total.Fill(*packet.mutable_total());
+    }
+}
+
+void Stats::Reset() {
+    std::unique_lock lock(statsMutex);
+    packetStats.clear();
+}
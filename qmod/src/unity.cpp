@@ -1,5 +1,8 @@
 #include "unity.hpp"
 
+#include <random>
+#include <regex>
+
 #include "UnityEngine/Component.hpp"
 #include "UnityEngine/Object.hpp"
 #include "UnityEngine/SceneManagement/Scene.hpp"
@@ -10,43 +13,35 @@
 
 using namespace UnityEngine;
 
-ProtoTransform ReadTransform(Transform* obj) {
-    ProtoTransform packet;
+static void ReadTransform(Transform* obj, ProtoTransform& packet) {
     packet.set_address(asInt(obj));
 
     packet.set_childcount(obj->get_childCount());
     packet.set_siblingidx(obj->GetSiblingIndex());
     packet.set_parent(asInt(obj->GetParent().unsafePtr()));
-    return packet;
 }
 
-ProtoGameObject ReadGameObject(GameObject* obj) {
-    ProtoGameObject packet;
+void ReadGameObject(GameObject* obj, ProtoGameObject& packet) {
     packet.set_address(asInt(obj));
     packet.set_name(obj->get_name());
-    *packet.mutable_transform() = ReadTransform(obj->get_transform());
+    ReadTransform(obj->get_transform(), *packet.mutable_transform());
 
     packet.set_active(obj->get_active());
     packet.set_layer(obj->get_layer());
     packet.set_scene(obj->get_scene().m_Handle);
     packet.set_instanceid(obj->GetInstanceID());
     packet.set_tag(obj->get_tag());
-    return packet;
 }
 
-ProtoScene ReadScene(SceneManagement::Scene scene) {
-    ProtoScene packet;
+static void ReadScene(SceneManagement::Scene scene, ProtoScene& packet) {
     packet.set_handle(scene.m_Handle);
     packet.set_loaded(scene.get_isLoaded());
     packet.set_name(scene.get_name());
     packet.set_rootcount(scene.get_rootCount());
     packet.set_active(SceneManagement::SceneManager::GetActiveScene().m_Handle == scene.m_Handle);
-    return packet;
 }
 
-GetGameObjectComponentsResult GetComponents(UnityEngine::GameObject* obj) {
-    GetGameObjectComponentsResult result;
-
+void GetComponents(UnityEngine::GameObject* obj, GetGameObjectComponentsResult& result) {
     for (auto const comp : obj->GetComponents<Component*>()) {
         ProtoComponent& found = *result.add_components();
 
@@ -54,49 +49,245 @@ GetGameObjectComponentsResult GetComponents(UnityEngine::GameObject* obj) {
         found.set_name(comp->get_name());
         *found.mutable_classinfo() = ClassUtils::GetClassInfo(typeofinst(comp));
     }
+}
 
-    return result;
+// the range of count items from offset, up to limit of them unless it is 0
+// worked out in 64 bits, as the offset and limit can be anything up to UINT32_MAX
+static std::pair<int, int> GetPage(int count, std::uint32_t offset, std::uint32_t limit) {
+    std::int64_t begin = std::min<std::int64_t>(offset, count);
+    std::int64_t end = limit > 0 ? std::min<std::int64_t>(count, begin + limit) : count;
+    return {(int) begin, (int) end};
 }
 
-static SearchObjectsResult ConvertObjects(std::span<UnityW<Object>> arr) {
-    SearchObjectsResult result;
+static void AddChildren(Transform* transform, int begin, int end, std::uint32_t depth, GetChildrenResult& result) {
+    for (int i = begin; i < end; i++) {
+        auto child = transform->GetChild(i);
+        ReadGameObject(child->get_gameObject(), *result.add_objects());
+        if (depth > 0)
+            AddChildren(child, 0, child->get_childCount(), depth - 1, result);
+    }
+}
+
+void FindChildren(Transform* transform, std::uint32_t offset, std::uint32_t limit, std::uint32_t depth, GetChildrenResult& result) {
+    auto [begin, end] = GetPage(transform->get_childCount(), offset, limit);
+    AddChildren(transform, begin, end, depth, result);
+}
+
+void FindSceneRoots(std::optional<int> scene, std::uint32_t offset, std::uint32_t limit, GetSceneRootsResult& result) {
+    for (int i = 0; i < SceneManagement::SceneManager::get_sceneCount(); i++) {
+        auto found = SceneManagement::SceneManager::GetSceneAt(i);
+        if ((scene && found.m_Handle != *scene) || !found.get_isLoaded())
+            continue;
+        ReadScene(found, *result.add_scenes());
+
+        auto roots = found.GetRootGameObjects();
+        auto [begin, end] = GetPage(roots.size(), offset, limit);
+        for (int j = begin; j < end; j++)
+            ReadGameObject(roots[j], *result.add_objects());
+    }
+}
+
+static void ConvertObjects(std::span<UnityW<Object>> arr, SearchObjectsResult& result) {
     for (auto obj : arr) {
         ProtoObject& found = *result.add_objects();
         found.set_address(asInt(obj.unsafePtr()));
         found.set_name(obj->get_name());
         *found.mutable_classinfo() = ClassUtils::GetClassInfo(typeofinst(obj));
     }
-    return result;
 }
 
-SearchObjectsResult FindObjects(Il2CppClass* clazz, std::string name) {
+// a name or tag filter, set up once and then matched without calling any managed string functions
+class TextMatcher {
+    std::string text;
+    bool caseSensitive;
+    std::optional<std::regex> regex;
+
+   public:
+    TextMatcher(std::string text, bool caseSensitive) : text(std::move(text)), caseSensitive(caseSensitive) {}
+    TextMatcher(QueryGameObjects::TextFilter const& filter) : TextMatcher(filter.contains(), filter.casesensitive()) {
+        if (filter.has_regex()) {
+            auto flags = std::regex::ECMAScript | std::regex::optimize;
+            regex.emplace(filter.regex(), caseSensitive ? flags : flags | std::regex::icase);
+        }
+    }
+
+    bool Matches(std::string_view value) const {
+        if (regex)
+            return std::regex_search(value.begin(), value.end(), *regex);
+        if (caseSensitive)
+            return value.find(text) != std::string_view::npos;
+        return ContainsAnyCase(value, text);
+    }
+};
+
+void FindObjects(Il2CppClass* clazz, std::string name, SearchObjectsResult& result) {
     LOG_DEBUG("Searching for objects");
     auto objects = Object::FindObjectsOfType(reinterpret_cast<System::Type*>(il2cpp_utils::GetSystemType(clazz)), true);
 
     if (!name.empty()) {
         LOG_DEBUG("Searching for name {}", name);
-        StringW il2cppName(name);
+        // case sensitive, like String.Contains
+        TextMatcher matcher(std::move(name), true);
         std::vector<UnityW<Object>> namedObjs;
         for (auto obj : objects) {
-            if (obj->get_name()->Contains(il2cppName))
+            if (matcher.Matches(static_cast<std::string>(obj->get_name())))
                 namedObjs.push_back(obj);
         }
-        return ConvertObjects(namedObjs);
-    }
-    return ConvertObjects(objects.ref_to());
+        ConvertObjects(namedObjs, result);
+    } else
+        ConvertObjects(objects.ref_to(), result);
 }
 
-GetAllGameObjectsResult FindAllGameObjects() {
-    GetAllGameObjectsResult result;
+void FilterGameObjects(QueryGameObjects const& query, Il2CppClass* component, QueryGameObjectsResult& result) {
+    auto name = query.has_name() ? std::optional<TextMatcher>(query.name()) : std::nullopt;
+    auto tag = query.has_tag() ? std::optional<TextMatcher>(query.tag()) : std::nullopt;
+    auto componentType = component ? reinterpret_cast<System::Type*>(il2cpp_utils::GetSystemType(component)) : nullptr;
 
     auto objects = Object::FindObjectsOfType<GameObject*>(true);
-    result.mutable_objects()->Reserve(objects.size());
-    LOG_DEBUG("found {} game objects", objects.size());
-    for (auto const& obj : objects)
-        *result.add_objects() = ReadGameObject(obj);
+    LOG_DEBUG("filtering {} game objects", objects.size());
+    for (auto const& obj : objects) {
+        // the cheapest checks go first, and the strings are only read if everything else matched
+        if (query.has_layer() && obj->get_layer() != query.layer())
+            continue;
+        if (query.has_active() && obj->get_active() != query.active())
+            continue;
+        if (query.has_scene() && obj->get_scene().m_Handle != query.scene())
+            continue;
+        if (componentType && !obj->GetComponent(componentType))
+            continue;
+        if (name && !name->Matches(static_cast<std::string>(obj->get_name())))
+            continue;
+        if (tag && !tag->Matches(static_cast<std::string>(obj->get_tag())))
+            continue;
 
+        if (query.limit() > 0 && (std::uint32_t) result.objects_size() >= query.limit()) {
+            result.set_truncated(true);
+            break;
+        }
+        ReadGameObject(obj, *result.add_objects());
+    }
+}
+
+static void AddScenes(GetAllGameObjectsResult& result) {
     for (int i = 0; i < SceneManagement::SceneManager::get_sceneCount(); i++)
-        *result.add_scenes() = ReadScene(SceneManagement::SceneManager::GetSceneAt(i));
+        ReadScene(SceneManagement::SceneManager::GetSceneAt(i), *result.add_scenes());
+}
+
+// what was last read of each object by instance id, to find the changes since a generation
+struct HierarchyEntry {
+    std::size_t hash;
+    // the generation the object was last added, changed or removed in, and was last found in
+    std::uint64_t changed;
+    std::uint64_t seen;
+    bool removed;
+};
 
-    return result;
+// only used on the main thread, where the objects are found
+static std::unordered_map<int, HierarchyEntry> hierarchy;
+static std::uint64_t generation = 0;
+
+// removed objects are forgotten after a while, so earlier generations can't be compared against
+static std::uint64_t oldestGeneration = 0;
+static std::size_t removedCount = 0;
+
+// random for each run of the mod and sent as the high half of the generation, so a result from an earlier run isn't compared against
+static std::uint64_t NewEpoch() {
+    std::random_device random;
+    return std::uniform_int_distribution<std::uint32_t>(1, UINT32_MAX)(random);
+}
+static std::uint64_t const epoch = NewEpoch();
+
+static std::size_t HashGameObject(ProtoGameObject const& obj) {
+    std::size_t hash = std::hash<std::string>{}(obj.name());
+    auto combine = [&hash](std::size_t value) { hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2); };
+    combine(std::hash<std::string>{}(obj.tag()));
+    auto& transform = obj.transform();
+    for (std::uint64_t value : {obj.address(), transform.address(), transform.parent()})
+        combine(value);
+    for (std::int64_t value : {transform.childcount(), transform.siblingidx(), obj.layer(), obj.scene(), (int) obj.active()})
+        combine(value);
+    return hash;
+}
+
+// every object is still read to find changes, but only the changed ones are kept in the result
+// with indices, the positions of the changed ones are added to it instead, so they can be read again later
+static void FindGameObjects(
+    ArrayW<GameObject*> const& objects, std::optional<std::uint64_t> token, GetAllGameObjectsResult& result, std::vector<std::uint32_t>* indices
+) {
+    auto since = token && (*token >> 32) == epoch ? std::optional(*token & 0xffffffff) : std::nullopt;
+    bool partial = since && *since >= oldestGeneration && *since <= generation;
+    generation++;
+
+    if (!partial && !indices)
+        result.mutable_objects()->Reserve(objects.size());
+    LOG_DEBUG("found {} game objects", objects.size());
+    for (std::uint32_t i = 0; i < objects.size(); i++) {
+        auto& read = *result.add_objects();
+        ReadGameObject(objects[i], read);
+
+        auto hash = HashGameObject(read);
+        auto [entry, added] = hierarchy.try_emplace(read.instanceid(), HierarchyEntry{hash, generation, generation, false});
+        auto& last = entry->second;
+        if (!added && (last.removed || last.hash != hash)) {
+            if (last.removed)
+                removedCount--;
+            last = {hash, generation, generation, false};
+        }
+        last.seen = generation;
+
+        bool changed = !partial || last.changed > *since;
+        if (changed && indices)
+            indices->emplace_back(i);
+        if (!changed || indices)
+            result.mutable_objects()->RemoveLast();
+    }
+
+    for (auto& [id, entry] : hierarchy) {
+        if (!entry.removed && entry.seen != generation) {
+            entry = {entry.hash, generation, entry.seen, true};
+            removedCount++;
+        }
+        if (partial && entry.removed && entry.changed > *since)
+            result.add_removed(id);
+    }
+    // once they outnumber the objects still around, removed ones are forgotten, and older generations get everything
+    if (removedCount > objects.size()) {
+        std::erase_if(hierarchy, [](auto const& pair) { return pair.second.removed; });
+        removedCount = 0;
+        oldestGeneration = generation;
+    }
+
+    result.set_generation((epoch << 32) | generation);
+    result.set_partial(partial);
+    AddScenes(result);
+}
+
+void FindAllGameObjects(GetAllGameObjectsResult& result, std::optional<std::uint64_t> since) {
+    FindGameObjects(Object::FindObjectsOfType<GameObject*>(true), since, result, nullptr);
+}
+
+HierarchyStream::HierarchyStream(std::optional<std::uint64_t> since) : objects(Object::FindObjectsOfType<GameObject*>(true)) {
+    // the array keeps every object in it from being collected, even once destroyed
+    handle = il2cpp_functions::gchandle_new(static_cast<Il2CppObject*>(objects.convert()), false);
+    FindGameObjects(objects, since, last, &indices);
+}
+
+HierarchyStream::~HierarchyStream() {
+    il2cpp_functions::gchandle_free(handle);
+}
+
+bool HierarchyStream::Next(std::size_t count, GetAllGameObjectsResult& result) {
+    auto end = std::min(next + count, indices.size());
+    result.mutable_objects()->Reserve(end - next);
+    for (; next < end; next++) {
+        auto obj = objects[indices[next]];
+        // destroyed since the changes were found, so it will be removed in the next generation
+        if (!UnityW<GameObject>(obj))
+            continue;
+        ReadGameObject(obj, *result.add_objects());
+    }
+    if (next < indices.size())
+        return false;
+    result.MergeFrom(last);
+    return true;
 }
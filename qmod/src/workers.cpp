@@ -0,0 +1,63 @@
+#include "workers.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "main.hpp"
+
+static std::vector<std::thread> workerThreads;
+static std::deque<Task> tasks;
+static std::mutex tasksMutex;
+static std::condition_variable tasksAvailable;
+static bool stopping = false;
+
+static void RunWorker() {
+    auto thread = il2cpp_functions::thread_attach(il2cpp_functions::domain_get());
+
+    while (true) {
+        std::unique_lock lock(tasksMutex);
+        tasksAvailable.wait(lock, []() { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+            break;
+        auto task = std::move(tasks.front());
+        tasks.pop_front();
+        lock.unlock();
+
+        task();
+    }
+
+    il2cpp_functions::thread_detach(thread);
+}
+
+void Workers::Start(int threads) {
+    std::unique_lock lock(tasksMutex);
+    stopping = false;
+    lock.unlock();
+
+    for (int i = 0; i < std::max(threads, 1); i++)
+        workerThreads.emplace_back(RunWorker);
+    LOG_INFO("running {} worker threads", workerThreads.size());
+}
+
+void Workers::Stop() {
+    std::unique_lock lock(tasksMutex);
+    stopping = true;
+    lock.unlock();
+    tasksAvailable.notify_all();
+
+    // queued tasks are still finished first
+    for (auto& thread : workerThreads)
+        thread.join();
+    workerThreads.clear();
+}
+
+void Workers::Schedule(Task task) {
+    if (!task)
+        return;
+    std::unique_lock lock(tasksMutex);
+    tasks.emplace_back(std::move(task));
+    lock.unlock();
+    tasksAvailable.notify_one();
+}